@@ -0,0 +1,222 @@
+#include "benchmark.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <regex>
+#include <sstream>
+#include <thread>
+
+namespace bench {
+
+namespace {
+
+struct Registered {
+    std::string name;
+    Function function;
+};
+
+struct Result {
+    std::string name;
+    int64_t iterations = 0;
+    double realTime = 0.0;      // ns per iteration
+    double cpuTime = 0.0;
+    double itemsPerSecond = 0.0;
+    std::string error;
+};
+
+std::vector<Registered>& registry() {
+    static std::vector<Registered> benchmarks;
+    return benchmarks;
+}
+
+// Match google-benchmark: grow the iteration count until one run takes at
+// least minTime, then report that run
+Result runOne(const Registered& benchmark, double minTime) {
+    constexpr int64_t kMaxIterations = 1000000000;
+    int64_t iterations = 1;
+    while (true) {
+        State state(iterations);
+        benchmark.function(state);
+
+        double seconds = state.realSeconds();
+        if (!state.error().empty() || seconds >= minTime || iterations >= kMaxIterations) {
+            Result result;
+            result.name = benchmark.name;
+            result.iterations = iterations;
+            result.error = state.error();
+            result.realTime = seconds * 1e9 / iterations;
+            result.cpuTime = state.cpuSeconds() * 1e9 / iterations;
+            if (state.itemsProcessed() > 0 && seconds > 0.0) {
+                result.itemsPerSecond = static_cast<double>(state.itemsProcessed()) * iterations / seconds;
+            }
+            return result;
+        }
+
+        // Aim 40% past the target, growing at most 10x per round
+        double multiplier = seconds > 0.0 ? minTime * 1.4 / seconds : 10.0;
+        multiplier = std::min(10.0, std::max(multiplier, 1.0));
+        iterations = std::min(kMaxIterations, std::max(iterations + 1,
+                              static_cast<int64_t>(iterations * multiplier)));
+    }
+}
+
+std::string escape(const std::string& text) {
+    std::string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped.push_back('\\');
+        }
+        escaped.push_back(c);
+    }
+    return escaped;
+}
+
+std::string currentDate() {
+    std::time_t now = std::time(nullptr);
+    char buffer[32];
+    std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+    return buffer;
+}
+
+void writeJson(std::ostream& out, const std::vector<Result>& results, const std::string& executable) {
+    out << "{\n";
+    out << "  \"context\": {\n";
+    out << "    \"date\": \"" << currentDate() << "\",\n";
+    out << "    \"executable\": \"" << escape(executable) << "\",\n";
+    out << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n";
+#ifdef NDEBUG
+    out << "    \"library_build_type\": \"release\"\n";
+#else
+    out << "    \"library_build_type\": \"debug\"\n";
+#endif
+    out << "  },\n";
+    out << "  \"benchmarks\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& result = results[i];
+        out << (i == 0 ? "\n" : ",\n");
+        out << "    {\n";
+        out << "      \"name\": \"" << escape(result.name) << "\",\n";
+        out << "      \"run_name\": \"" << escape(result.name) << "\",\n";
+        out << "      \"run_type\": \"iteration\",\n";
+        if (!result.error.empty()) {
+            out << "      \"error_occurred\": true,\n";
+            out << "      \"error_message\": \"" << escape(result.error) << "\",\n";
+        }
+        out << "      \"iterations\": " << result.iterations << ",\n";
+        out << std::setprecision(10);
+        out << "      \"real_time\": " << result.realTime << ",\n";
+        out << "      \"cpu_time\": " << result.cpuTime << ",\n";
+        if (result.itemsPerSecond > 0.0) {
+            out << "      \"items_per_second\": " << result.itemsPerSecond << ",\n";
+        }
+        out << "      \"time_unit\": \"ns\"\n";
+        out << "    }";
+    }
+    out << "\n  ]\n}\n";
+}
+
+void writeConsole(std::ostream& out, const std::vector<Result>& results) {
+    size_t nameWidth = 10;
+    for (const Result& result : results) {
+        nameWidth = std::max(nameWidth, result.name.size());
+    }
+    out << std::left << std::setw(static_cast<int>(nameWidth)) << "Benchmark" << std::right
+        << std::setw(16) << "Time" << std::setw(16) << "CPU" << std::setw(12) << "Iterations" << "\n";
+    out << std::string(nameWidth + 44, '-') << "\n";
+    for (const Result& result : results) {
+        out << std::left << std::setw(static_cast<int>(nameWidth)) << result.name << std::right;
+        if (!result.error.empty()) {
+            out << "  ERROR: " << result.error << "\n";
+            continue;
+        }
+        out << std::fixed << std::setprecision(0)
+            << std::setw(13) << result.realTime << " ns"
+            << std::setw(13) << result.cpuTime << " ns"
+            << std::setw(12) << result.iterations;
+        if (result.itemsPerSecond > 0.0) {
+            out << std::setprecision(2) << "  items/s=" << result.itemsPerSecond / 1e6 << "M";
+        }
+        out << std::defaultfloat << "\n";
+    }
+}
+
+void write(std::ostream& out, const std::string& format, const std::vector<Result>& results,
+           const std::string& executable) {
+    if (format == "json") {
+        writeJson(out, results, executable);
+    }
+    else {
+        writeConsole(out, results);
+    }
+}
+
+} // namespace
+
+void registerBenchmark(const std::string& name, Function function) {
+    registry().push_back({name, std::move(function)});
+}
+
+int runBenchmarks(int argc, char** argv) {
+    std::string filter = ".";
+    double minTime = 0.5;
+    std::string format = "console";
+    std::string outPath;
+    std::string outFormat = "json";
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&arg](const std::string& flag) {
+            return arg.compare(0, flag.size() + 1, flag + "=") == 0 ? arg.substr(flag.size() + 1) : std::string();
+        };
+        if (!value("--benchmark_filter").empty()) {
+            filter = value("--benchmark_filter");
+        }
+        else if (!value("--benchmark_min_time").empty()) {
+            minTime = std::stod(value("--benchmark_min_time"));
+        }
+        else if (!value("--benchmark_format").empty()) {
+            format = value("--benchmark_format");
+        }
+        else if (!value("--benchmark_out").empty()) {
+            outPath = value("--benchmark_out");
+        }
+        else if (!value("--benchmark_out_format").empty()) {
+            outFormat = value("--benchmark_out_format");
+        }
+    }
+
+    std::regex pattern;
+    try {
+        pattern = std::regex(filter);
+    }
+    catch (const std::regex_error&) {
+        std::cerr << "Invalid --benchmark_filter: " << filter << std::endl;
+        return 1;
+    }
+
+    std::vector<Result> results;
+    for (const Registered& benchmark : registry()) {
+        if (!std::regex_search(benchmark.name, pattern)) {
+            continue;
+        }
+        if (format != "json") {
+            std::cerr << "Running " << benchmark.name << std::endl;
+        }
+        results.push_back(runOne(benchmark, minTime));
+    }
+
+    write(std::cout, format, results, argv[0]);
+    if (!outPath.empty()) {
+        std::ofstream out(outPath);
+        if (!out) {
+            std::cerr << "Failed to write " << outPath << std::endl;
+            return 1;
+        }
+        write(out, outFormat, results, argv[0]);
+    }
+    return 0;
+}
+
+} // namespace bench
@@ -0,0 +1,99 @@
+#pragma once
+
+// Minimal benchmark harness with google-benchmark compatible flags and JSON
+// output, so results can be compared with its tools (e.g. compare.py)
+// without adding the dependency.
+
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+// Loop state handed to a benchmark body:
+//     while (state.keepRunning()) { ... }
+class State {
+public:
+    explicit State(int64_t iterations) : iterations_(iterations) {}
+
+    bool keepRunning() {
+        if (!started_) {
+            started_ = true;
+            remaining_ = iterations_;
+            resumeTiming();
+        }
+        if (remaining_ > 0 && error_.empty()) {
+            --remaining_;
+            return true;
+        }
+        pauseTiming();
+        return false;
+    }
+
+    // Exclude per-iteration setup from the measurement
+    void pauseTiming() {
+        if (running_) {
+            realTime_ += std::chrono::steady_clock::now() - realStart_;
+            cpuTime_ += std::clock() - cpuStart_;
+            running_ = false;
+        }
+    }
+    void resumeTiming() {
+        if (!running_) {
+            realStart_ = std::chrono::steady_clock::now();
+            cpuStart_ = std::clock();
+            running_ = true;
+        }
+    }
+
+    // Items handled per iteration, reported as items_per_second
+    void setItemsProcessed(int64_t items) { itemsProcessed_ = items; }
+
+    // Abort the benchmark; it is reported with error_occurred
+    void skipWithError(const std::string& message) { error_ = message; }
+
+    int64_t iterations() const { return iterations_; }
+    double realSeconds() const { return std::chrono::duration<double>(realTime_).count(); }
+    double cpuSeconds() const { return static_cast<double>(cpuTime_) / CLOCKS_PER_SEC; }
+    int64_t itemsProcessed() const { return itemsProcessed_; }
+    const std::string& error() const { return error_; }
+
+private:
+    int64_t iterations_;
+    int64_t remaining_ = 0;
+    bool started_ = false;
+    bool running_ = false;
+    std::chrono::steady_clock::time_point realStart_;
+    std::chrono::steady_clock::duration realTime_{0};
+    std::clock_t cpuStart_ = 0;
+    std::clock_t cpuTime_ = 0;
+    int64_t itemsProcessed_ = 0;
+    std::string error_;
+};
+
+using Function = std::function<void(State&)>;
+
+// Add a benchmark to the run; call before runBenchmarks
+void registerBenchmark(const std::string& name, Function function);
+
+// Parse --benchmark_filter=REGEX, --benchmark_min_time=SECONDS,
+// --benchmark_format=console|json, --benchmark_out=FILE and
+// --benchmark_out_format=console|json, run the matching benchmarks and
+// report them. Returns the process exit code.
+int runBenchmarks(int argc, char** argv);
+
+// Keep the compiler from discarding a computed value
+template <typename T>
+inline void doNotOptimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const T* sink;
+    sink = &value;
+#endif
+}
+
+} // namespace bench
@@ -0,0 +1,278 @@
+#include "benchmark.hpp"
+#include "image_compressor.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifndef IC_SAMPLE_DIR
+#define IC_SAMPLE_DIR "."
+#endif
+
+namespace ic {
+
+// Reaches the grower's private kernels (befriended by AdaptiveRegionGrower)
+struct GrowerBenchmarkAccess {
+    static double adaptiveThreshold(const AdaptiveRegionGrower& grower, int x, int y) {
+        return grower.calculateAdaptiveThreshold(x, y);
+    }
+    static double cachedSimilarity(AdaptiveRegionGrower& grower, const Color& c1, const Color& c2) {
+        return grower.getCachedSimilarity(c1, c2);
+    }
+    static std::vector<Point> neighbors(const AdaptiveRegionGrower& grower, int x, int y) {
+        return grower.getNeighbors(x, y, true);
+    }
+};
+
+} // namespace ic
+
+namespace {
+
+using ic::Color;
+using ic::Image;
+
+constexpr int kImageSize = 256;
+constexpr double kThreshold = 0.9;
+constexpr int kMaxRegionSize = 5000;
+
+struct NamedImage {
+    std::string name;
+    std::shared_ptr<const Image> image;
+};
+
+std::shared_ptr<Image> makeFlat() {
+    auto image = std::make_shared<Image>(kImageSize, kImageSize);
+    std::fill(image->data(), image->data() + image->getPixelCount(), Color(96, 128, 160));
+    return image;
+}
+
+std::shared_ptr<Image> makeGradient() {
+    auto image = std::make_shared<Image>(kImageSize, kImageSize);
+    for (int y = 0; y < kImageSize; ++y) {
+        for (int x = 0; x < kImageSize; ++x) {
+            image->at(x, y) = Color(static_cast<uint8_t>(x), static_cast<uint8_t>(y),
+                                    static_cast<uint8_t>((x + y) / 2));
+        }
+    }
+    return image;
+}
+
+std::shared_ptr<Image> makeNoise() {
+    auto image = std::make_shared<Image>(kImageSize, kImageSize);
+    std::mt19937 random(42);
+    std::uniform_int_distribution<int> channel(0, 255);
+    for (size_t i = 0; i < image->getPixelCount(); ++i) {
+        image->data()[i] = Color(static_cast<uint8_t>(channel(random)), static_cast<uint8_t>(channel(random)),
+                      static_cast<uint8_t>(channel(random)));
+    }
+    return image;
+}
+
+// Center crop of a photo, so natural texture is measured at the same size
+std::shared_ptr<Image> cropCenter(const Image& photo) {
+    int size = std::min({kImageSize, photo.getWidth(), photo.getHeight()});
+    auto image = std::make_shared<Image>(size, size);
+    int left = (photo.getWidth() - size) / 2;
+    int top = (photo.getHeight() - size) / 2;
+    for (int y = 0; y < size; ++y) {
+        ic::Span<const Color> row = photo.row(top + y);
+        std::copy(row.begin() + left, row.begin() + left + size, image->row(y).begin());
+    }
+    return image;
+}
+
+// Sample photos shipped with the repo (skipping our own outputs)
+std::vector<std::string> listSamples(const std::string& directory) {
+    std::vector<std::string> samples;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+        std::string name = entry.path().filename().string();
+        std::string extension = entry.path().extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(),
+                       [](unsigned char c) { return std::tolower(c); });
+        bool isImage = extension == ".jpg" || extension == ".jpeg" || extension == ".png" || extension == ".ppm";
+        if (entry.is_regular_file() && isImage && name.find("_compressed") == std::string::npos) {
+            samples.push_back(entry.path().string());
+        }
+    }
+    std::sort(samples.begin(), samples.end());
+    return samples;
+}
+
+// Horizontally adjacent pixel pairs: the comparisons region growth makes
+template <typename Kernel>
+void comparePairs(bench::State& state, const Image& image, Kernel kernel) {
+    int width = image.getWidth();
+    int height = image.getHeight();
+    while (state.keepRunning()) {
+        double sum = 0.0;
+        for (int y = 0; y < height; ++y) {
+            ic::Span<const Color> row = image.row(y);
+            for (int x = 0; x + 1 < width; ++x) {
+                sum += kernel(row[x], row[x + 1]);
+            }
+        }
+        bench::doNotOptimize(sum);
+    }
+    state.setItemsProcessed(static_cast<int64_t>(width - 1) * height);
+}
+
+void registerKernels(const NamedImage& input) {
+    std::shared_ptr<const Image> image = input.image;
+
+    bench::registerBenchmark("BM_ColorSimilarity/" + input.name, [image](bench::State& state) {
+        comparePairs(state, *image, [](const Color& a, const Color& b) { return ic::colorSimilarity(a, b); });
+    });
+
+    bench::registerBenchmark("BM_ColorDistance/" + input.name, [image](bench::State& state) {
+        comparePairs(state, *image, [](const Color& a, const Color& b) { return ic::colorDistance(a, b); });
+    });
+
+    // Each accepted pixel's 8 neighbors against the seed and the pixel itself
+    for (ic::SimdLevel level : {ic::SimdLevel::SCALAR, ic::SimdLevel::SSE4, ic::SimdLevel::AVX2,
+                                ic::SimdLevel::NEON}) {
+        if (level != ic::SimdLevel::SCALAR && ic::bestSquaredDistanceKernel(level) ==
+                                              ic::bestSquaredDistanceKernel(ic::SimdLevel::SCALAR)) {
+            continue;
+        }
+        std::string name = std::string("BM_BestSquaredDistance/") + ic::simdLevelName(level) + "/" + input.name;
+        bench::registerBenchmark(name, [image, level](bench::State& state) {
+            ic::BestSquaredDistanceKernel kernel = ic::bestSquaredDistanceKernel(level);
+            int width = image->getWidth();
+            int height = image->getHeight();
+            while (state.keepRunning()) {
+                int64_t sum = 0;
+                for (int y = 1; y + 1 < height; ++y) {
+                    for (int x = 1; x + 1 < width; ++x) {
+                        ic::ColorBatch batch;
+                        for (const auto& offset : ic::RegionGrower::kNeighborOffsets) {
+                            batch.add(image->at(x + offset[0], y + offset[1]));
+                        }
+                        int32_t best[ic::ColorBatch::kLanes];
+                        kernel(image->at(0, 0), image->at(x, y), batch, best);
+                        sum += best[0] + best[7];
+                    }
+                }
+                bench::doNotOptimize(sum);
+            }
+            state.setItemsProcessed(static_cast<int64_t>(width - 2) * (height - 2) * 16);
+        });
+    }
+
+    bench::registerBenchmark("BM_CachedSimilarity/" + input.name, [image](bench::State& state) {
+        ic::AdaptiveRegionGrower grower(*image, kThreshold, kMaxRegionSize);
+        comparePairs(state, *image, [&grower](const Color& a, const Color& b) {
+            return ic::GrowerBenchmarkAccess::cachedSimilarity(grower, a, b);
+        });
+    });
+
+    bench::registerBenchmark("BM_AdaptiveThreshold/" + input.name, [image](bench::State& state) {
+        ic::AdaptiveRegionGrower grower(*image, kThreshold, kMaxRegionSize);
+        while (state.keepRunning()) {
+            double sum = 0.0;
+            for (int y = 0; y < image->getHeight(); ++y) {
+                for (int x = 0; x < image->getWidth(); ++x) {
+                    sum += ic::GrowerBenchmarkAccess::adaptiveThreshold(grower, x, y);
+                }
+            }
+            bench::doNotOptimize(sum);
+        }
+        state.setItemsProcessed(static_cast<int64_t>(image->getPixelCount()));
+    });
+
+    bench::registerBenchmark("BM_GetNeighbors/" + input.name, [image](bench::State& state) {
+        ic::AdaptiveRegionGrower grower(*image, kThreshold, kMaxRegionSize);
+        while (state.keepRunning()) {
+            size_t count = 0;
+            for (int y = 0; y < image->getHeight(); ++y) {
+                for (int x = 0; x < image->getWidth(); ++x) {
+                    count += ic::GrowerBenchmarkAccess::neighbors(grower, x, y).size();
+                }
+            }
+            bench::doNotOptimize(count);
+        }
+        state.setItemsProcessed(static_cast<int64_t>(image->getPixelCount()));
+    });
+
+    bench::registerBenchmark("BM_FindRegion/" + input.name, [image](bench::State& state) {
+        ic::AdaptiveRegionGrower grower(*image, kThreshold, kMaxRegionSize);
+        ic::LabelMap labels(image->getWidth(), image->getHeight());
+        int seedX = image->getWidth() / 2;
+        int seedY = image->getHeight() / 2;
+        ic::RegionBuffer buffer;
+        size_t pixels = 0;
+        while (state.keepRunning()) {
+            buffer.clear();
+            ic::RegionView region = grower.appendRegion(seedX, seedY, labels, buffer);
+            pixels = region.length;
+            bench::doNotOptimize(buffer.indices(region).data());
+        }
+        state.setItemsProcessed(static_cast<int64_t>(pixels));
+    });
+}
+
+// Decode and compress one sample with the default adaptive settings
+void registerEndToEnd(const std::string& path) {
+    std::string name = "BM_Compress/" + std::filesystem::path(path).filename().string();
+    bench::registerBenchmark(name, [path](bench::State& state) {
+        int64_t pixels = 0;
+        while (state.keepRunning()) {
+            // Decode without loadImage, which logs to stdout (where JSON goes)
+            ic::ImageCompressor compressor(kThreshold, kMaxRegionSize);
+            compressor.setReportEnabled(false);
+            try {
+                compressor.setImage(std::make_shared<Image>(path));
+            }
+            catch (const std::exception& e) {
+                state.skipWithError(e.what());
+                break;
+            }
+            if (!compressor.compress()) {
+                state.skipWithError("failed to compress " + path);
+                break;
+            }
+            pixels = static_cast<int64_t>(compressor.getStats().getSummary().at("total_pixels"));
+        }
+        state.setItemsProcessed(pixels);
+    });
+}
+
+} // namespace
+
+// Usage: bench [--samples=DIR] [google-benchmark flags]
+int main(int argc, char** argv) {
+    std::string sampleDir = IC_SAMPLE_DIR;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 10, "--samples=") == 0) {
+            sampleDir = arg.substr(10);
+        }
+    }
+    std::vector<std::string> samples = listSamples(sampleDir);
+
+    std::vector<NamedImage> images = {
+        {"flat", makeFlat()},
+        {"gradient", makeGradient()},
+        {"noise", makeNoise()},
+    };
+    for (const std::string& sample : samples) {
+        try {
+            images.push_back({"natural", cropCenter(Image(sample))});
+            break;
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Skipping natural image: " << e.what() << std::endl;
+        }
+    }
+
+    for (const NamedImage& image : images) {
+        registerKernels(image);
+    }
+    for (const std::string& sample : samples) {
+        registerEndToEnd(sample);
+    }
+    return bench::runBenchmarks(argc, argv);
+}
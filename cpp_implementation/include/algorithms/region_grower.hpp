@@ -1,76 +1,273 @@
 #pragma once
 
 #include "utils/image_utils.hpp"
+#include "utils/similarity_cache.hpp"
+#include "utils/color_tables.hpp"
+#include "utils/simd_distance.hpp"
+#include "utils/local_statistics.hpp"
+#include "utils/label_map.hpp"
+#include "utils/region_sums.hpp"
+#include "utils/region_buffer.hpp"
+#include "utils/bucket_queue.hpp"
 #include <vector>
-#include <unordered_set>
-#include <unordered_map>
 #include <memory>
 #include <string>
+#include <array>
+#include <utility>
 
 namespace ic {
 
+// Which neighbors of a pixel count as adjacent when growing a region
+enum class Connectivity {
+    FOUR = 4,     // N, S, W, E (as the Python RegionPathfinder)
+    EIGHT = 8     // plus the four diagonals
+};
+
+// Structure holding the candidate pixels while a region grows
+enum class FrontierMode {
+    HEAP,      // binary heap on exact priorities; stale duplicates skipped on pop
+    BUCKET     // bucket queue on priorities quantized to 1/1024, one entry per pixel
+};
+
 // Base class for region growing algorithms
 class RegionGrower {
 public:
+    // maxRegionSize <= 0 means regions are never capped
     RegionGrower(const Image& image, double similarityThreshold, int maxRegionSize = 0);
     virtual ~RegionGrower() = default;
-    
-    // Find a region starting from a seed point
-    virtual std::vector<Point> findRegion(int seedX, int seedY, 
-                                         const std::vector<std::vector<bool>>& processed) = 0;
-                                         
+
+    // Grow a region from a seed point and append its pixel indices to out.
+    // Pixels already assigned in labels are never included. Growers reuse
+    // their scratch state across calls, so with a reused buffer this does
+    // no heap allocation once warmed up.
+    virtual RegionView appendRegion(int seedX, int seedY, const LabelMap& labels, RegionBuffer& out) = 0;
+
+    // appendRegion returning points (allocates; for callers that want them)
+    std::vector<Point> findRegion(int seedX, int seedY, const LabelMap& labels);
+
+    // Channel sums and bounding box of the region the last findRegion
+    // returned, gathered while it grew
+    const RegionStats& getLastRegionStats() const { return lastStats_; }
+
+    // Whether the last region stopped at maxRegionSize with pixels it could
+    // still have taken; each such region costs an extra seed
+    bool lastRegionTruncated() const { return lastTruncated_; }
+
+    // Select direct (double) or table-based similarity evaluation
+    void setDistanceMode(DistanceMode mode) { distanceMode_ = mode; }
+    DistanceMode getDistanceMode() const { return distanceMode_; }
+
+    // Restrict growth to a sub-rectangle of the image (e.g. one tile)
+    void setBounds(const Rect& bounds) { bounds_ = bounds; }
+    const Rect& getBounds() const { return bounds_; }
+
+    // 4- or 8-connected growth [default: 8]
+    void setConnectivity(Connectivity connectivity) { connectivity_ = connectivity; }
+    Connectivity getConnectivity() const { return connectivity_; }
+
+    // Neighbor offsets in the order N, S, W, E, NW, SW, NE, SE (same order as
+    // the Python version); 4-connectivity uses the first four
+    static constexpr int kNeighborOffsets[8][2] = {
+        {0, -1}, {0, 1}, {-1, 0}, {1, 0},
+        {-1, -1}, {-1, 1}, {1, -1}, {1, 1}
+    };
+
 protected:
     const Image& image_;
     double similarityThreshold_;
     int maxRegionSize_;
     int width_;
     int height_;
-    
-    // Helper method to get neighboring pixels
+    DistanceMode distanceMode_ = DistanceMode::DIRECT;
+    Rect bounds_;
+    Connectivity connectivity_ = Connectivity::EIGHT;
+    RegionStats lastStats_;
+    bool lastTruncated_ = false;
+
+    // Helper method to get neighboring pixels (allocates; prefer forEachNeighbor)
     std::vector<Point> getNeighbors(int x, int y, bool include8Connected = false) const;
-    
-    // Check if coordinates are valid
+
+    // Call visit(nx, ny) for every neighbor of (x, y) inside the bounds,
+    // without allocating. Pixels away from the bounds' edges take a fast
+    // path with no per-neighbor bounds checks.
+    template <Connectivity C, typename Visitor>
+    void forEachNeighbor(int x, int y, Visitor&& visit) const {
+        constexpr int count = static_cast<int>(C);
+        if (x > bounds_.x && y > bounds_.y &&
+            x < bounds_.x + bounds_.width - 1 && y < bounds_.y + bounds_.height - 1) {
+            for (int i = 0; i < count; ++i) {
+                visit(x + kNeighborOffsets[i][0], y + kNeighborOffsets[i][1]);
+            }
+            return;
+        }
+        for (int i = 0; i < count; ++i) {
+            int nx = x + kNeighborOffsets[i][0];
+            int ny = y + kNeighborOffsets[i][1];
+            if (isValidCoordinate(nx, ny)) {
+                visit(nx, ny);
+            }
+        }
+    }
+
+    // Check if coordinates are valid (inside the growth bounds)
     bool isValidCoordinate(int x, int y) const {
-        return x >= 0 && x < width_ && y >= 0 && y < height_;
+        return bounds_.contains(x, y);
+    }
+
+    // Index of a pixel in the image, as stored in a RegionBuffer
+    uint32_t imageIndex(int x, int y) const {
+        return static_cast<uint32_t>(y) * static_cast<uint32_t>(width_) + static_cast<uint32_t>(x);
+    }
+
+    // Index of a pixel relative to the growth bounds
+    size_t localIndex(int x, int y) const {
+        return static_cast<size_t>(y - bounds_.y) * bounds_.width + (x - bounds_.x);
     }
 };
 
-// Adaptive region growing algorithm
-class AdaptiveRegionGrower : public RegionGrower {
+// Frontier entry of the adaptive grower's binary heap
+struct FrontierEntry {
+    double priority;       // Lower value = higher priority
+    Point point;
+
+    bool operator>(const FrontierEntry& other) const {
+        return priority > other.priority;
+    }
+};
+
+// Per-seed working memory of a grower, reset in O(1) between seeds. Each
+// grower owns one and growers are never shared between threads, so this is
+// a per-thread arena.
+struct GrowthScratch {
+    VisitedBuffer inRegion;               // membership of the region being grown
+    std::vector<FrontierEntry> heap;      // binary-heap frontier storage
+    BucketQueue bucketQueue;              // bucketed frontier storage
+};
+
+// Adaptive region growing algorithm. The growth loop is instantiated for
+// every combination of connectivity, metric, frontier, adaptive mode, size
+// cap and running mean; appendRegion picks the instantiation when those options change,
+// so the per-pixel loop has no branches on them.
+class AdaptiveRegionGrower final : public RegionGrower {
 public:
-    AdaptiveRegionGrower(const Image& image, double similarityThreshold, 
-                        int maxRegionSize = 0, bool adaptiveMode = true);
-    
-    std::vector<Point> findRegion(int seedX, int seedY, 
-                                 const std::vector<std::vector<bool>>& processed) override;
-    
+    // localStats may be shared between growers on the same image; when it is
+    // null and adaptive mode is on, the grower builds its own
+    AdaptiveRegionGrower(const Image& image, double similarityThreshold,
+                        int maxRegionSize = 0, bool adaptiveMode = true,
+                        size_t cacheEntries = SimilarityCache::kDefaultEntries,
+                        std::shared_ptr<const LocalStatistics> localStats = nullptr);
+
+    RegionView appendRegion(int seedX, int seedY, const LabelMap& labels, RegionBuffer& out) override;
+
+    // Window radius used to measure local variance
+    void setAdaptiveRadius(int radius) { adaptiveRadius_ = radius; }
+
+    // Compare candidates against the running region mean rather than the
+    // seed color; the mean is already being summed, so this costs nothing
+    void setRunningMean(bool enabled) { runningMean_ = enabled; }
+    bool getRunningMean() const { return runningMean_; }
+
+    // Binary heap or bucket queue for the growth frontier [default: heap]
+    void setFrontierMode(FrontierMode mode) { frontierMode_ = mode; }
+    FrontierMode getFrontierMode() const { return frontierMode_; }
+
+    // Cache statistics for reporting
+    const SimilarityCache& similarityCache() const { return similarityCache_; }
+
+    static constexpr int kDefaultAdaptiveRadius = 3;
+
 private:
+    // bench/ measures the private kernels directly
+    friend struct GrowerBenchmarkAccess;
+
     bool adaptiveMode_;
-    // Use string keys for the cache (much simpler)std::unordered_map<std::pair<Color, Color>, double, ColorPairHash> similarityCache_;
-    std::unordered_map<std::string, double> similarityCache_;
-    
-    // Calculate adaptive threshold based on local image characteristicsdouble calculateAdaptiveThreshold(int x, int y, int radius = 3) const;
-    double calculateAdaptiveThreshold(int x, int y, int radius = 3) const;
-    
-    // Get cached similarity value  double getCachedSimilarity(const Color& c1, const Color& c2);
-    double getCachedSimilarity(const Color& c1, const Color& c2);};
+    int adaptiveRadius_ = kDefaultAdaptiveRadius;
+    bool runningMean_ = false;
+    FrontierMode frontierMode_ = FrontierMode::HEAP;
+    SimilarityCache similarityCache_;
+    std::shared_ptr<const LocalStatistics> localStats_;
+
+    GrowthScratch scratch_;
+
+    // Neighbors of an accepted pixel are measured against the seed and the
+    // pixel in one batch, with the kernel picked for this CPU
+    BestSquaredDistanceKernel bestDistance_ = bestSquaredDistanceKernel();
+
+    // Calculate adaptive threshold based on local image characteristics
+    double calculateAdaptiveThreshold(int x, int y) const;
+
+    // Get cached similarity value
+    double getCachedSimilarity(const Color& c1, const Color& c2) {
+        return similarityCache_.get(c1, c2);
+    }
+
+    // Instantiated growth loop for the options packed in kernelKey()
+    using GrowKernel = RegionView (AdaptiveRegionGrower::*)(int seedX, int seedY, const LabelMap& labels,
+                                                            RegionBuffer& out);
+    GrowKernel kernel_ = nullptr;
+    uint32_t kernelKey_ = 0;
+
+    uint32_t kernelKey() const;
+    static GrowKernel kernelFor(uint32_t key);
+    template <uint32_t... Keys>
+    static std::array<GrowKernel, sizeof...(Keys)> kernelTable(std::integer_sequence<uint32_t, Keys...>);
+
+    // Build the metric and frontier for a key and run growRegion
+    template <uint32_t Key>
+    RegionView growKernel(int seedX, int seedY, const LabelMap& labels, RegionBuffer& out);
+
+    // Region growing loop, specialized on connectivity, adaptive thresholds,
+    // whether the size cap can be reached, running-mean seeds, how
+    // similarities are measured and the frontier structure
+    template <Connectivity C, bool Adaptive, bool Bounded, bool RunningMean, typename Metric, typename Frontier>
+    RegionView growRegion(int seedX, int seedY, const LabelMap& labels, RegionBuffer& out, Metric metric,
+                          Frontier frontier);
 };
 
-// Mean-shift based segmentationeanShiftSegmenter : public RegionGrower {
-class MeanShiftSegmenter : public RegionGrower {
+// Mean-shift segmentation in the joint spatial-color domain. Pixels are
+// bucketed into a grid of spatial cells and quantized colors; modes are
+// sought once per bin (in parallel, reusing modes other bins already
+// converged to), and nearby modes are merged. findRegion then returns the
+// connected pixels that share the seed's mode.
+class MeanShiftSegmenter final : public RegionGrower {
 public:
-    MeanShiftSegmenter(const Image& image, double colorBandwidth,                   double spatialBandwidth, int maxRegionSize = 0);
-                      double spatialBandwidth, int maxRegionSize = 0);
-    
-    std::vector<Point> findRegion(int seedX, int seedY,                              const std::vector<std::vector<bool>>& processed) override;
-                                 const std::vector<std::vector<bool>>& processed) override;
-    
+    // Bandwidths are normalized: color to [0, 1] per channel, spatial to the
+    // longer image side.
+    MeanShiftSegmenter(const Image& image, double colorBandwidth,
+                      double spatialBandwidth = kDefaultSpatialBandwidth, int maxRegionSize = 0);
+
+    RegionView appendRegion(int seedX, int seedY, const LabelMap& labels, RegionBuffer& out) override;
+
+    // Run mode seeking now instead of on the first findRegion
+    void segment();
+
+    // Threads used for mode seeking (0 = all hardware threads) [default: 1]
+    void setThreadCount(int threadCount) { threadCount_ = threadCount; }
+
+    // Grid bins and distinct modes after merging (valid after segment())
+    size_t getBinCount() const { return binCount_; }
+    size_t getModeCount() const { return modeCount_; }
+
+    static constexpr double kDefaultSpatialBandwidth = 0.05;
+
 private:
-    double colorBandwidth_;width_;
-    double spatialBandwidth_;  int spatialScale_;
-    int spatialScale_;};
-};
-} // namespace ic
+    double colorBandwidth_;
+    double spatialBandwidth_;
+    int spatialScale_;
+    int threadCount_ = 1;
+    bool segmented_ = false;
+    size_t binCount_ = 0;
+    size_t modeCount_ = 0;
+
+    // Mode id of every pixel, row-major
+    std::vector<uint32_t> modeLabels_;
 
+    // Membership of the region being collected
+    VisitedBuffer inRegion_;
 
-} // namespace ic
\ No newline at end of file
+    // Breadth-first collection of the connected pixels sharing a mode
+    template <Connectivity C>
+    RegionView floodRegion(int seedX, int seedY, const LabelMap& labels, RegionBuffer& out);
+};
+
+} // namespace ic
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "utils/image_utils.hpp"
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+namespace ic {
+
+// Order in which unassigned pixels are tried as region seeds
+enum class SeedOrder {
+    RASTER,      // row by row, as the Python version
+    GRADIENT,    // flattest pixels first, so regions start inside areas rather than on edges
+    GRID         // lowest-gradient pixel of each grid cell first, then raster for the rest
+};
+
+// Per-pixel gradient magnitude: L1 color difference to the right and lower
+// neighbors, 0..1530. Seeds in flat areas have low values.
+class GradientMap {
+public:
+    explicit GradientMap(const Image& image);
+
+    int getWidth() const { return width_; }
+    uint16_t at(int x, int y) const { return values_[static_cast<size_t>(y) * width_ + x]; }
+
+    static constexpr int kMaxValue = 2 * 3 * 255;
+
+private:
+    int width_;
+    std::vector<uint16_t> values_;
+};
+
+// Source of seed candidates for a raster of pixels. Candidates may already
+// belong to a region; callers skip those. Every pixel of the bounds is
+// produced at least once, so driving growth until next() fails labels all
+// of them.
+class SeedScheduler {
+public:
+    virtual ~SeedScheduler() = default;
+
+    // Start over for the pixels inside bounds (the image or one tile)
+    virtual void reset(const Rect& bounds) = 0;
+
+    // Next candidate; false when the bounds are exhausted
+    virtual bool next(int& x, int& y) = 0;
+};
+
+class RasterSeedScheduler : public SeedScheduler {
+public:
+    void reset(const Rect& bounds) override;
+    bool next(int& x, int& y) override;
+
+private:
+    Rect bounds_;
+    int x_ = 0;
+    int y_ = 0;
+};
+
+// Pixels of the bounds sorted by gradient (counting sort, stable, so ties
+// stay in raster order)
+class GradientSeedScheduler : public SeedScheduler {
+public:
+    explicit GradientSeedScheduler(std::shared_ptr<const GradientMap> gradient);
+
+    void reset(const Rect& bounds) override;
+    bool next(int& x, int& y) override;
+
+private:
+    std::shared_ptr<const GradientMap> gradient_;
+    std::vector<uint32_t> order_;     // pixel indices, flattest first
+    std::vector<uint32_t> counts_;    // counting-sort histogram, kept between resets
+    size_t position_ = 0;
+};
+
+// One seed per spacing x spacing cell, at the cell's flattest pixel, then
+// every pixel in raster order to pick up what the grid seeds left
+class GridSeedScheduler : public SeedScheduler {
+public:
+    GridSeedScheduler(std::shared_ptr<const GradientMap> gradient, int spacing = kDefaultSpacing);
+
+    void reset(const Rect& bounds) override;
+    bool next(int& x, int& y) override;
+
+    static constexpr int kDefaultSpacing = 16;
+
+private:
+    std::shared_ptr<const GradientMap> gradient_;
+    int spacing_;
+    std::vector<Point> gridSeeds_;
+    size_t position_ = 0;
+    RasterSeedScheduler raster_;
+};
+
+// Scheduler for an order; gradient may be null for RASTER only
+std::unique_ptr<SeedScheduler> createSeedScheduler(SeedOrder order, std::shared_ptr<const GradientMap> gradient);
+
+} // namespace ic
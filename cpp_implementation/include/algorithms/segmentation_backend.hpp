@@ -0,0 +1,51 @@
+#pragma once
+
+#include "algorithms/region_grower.hpp"
+#include "utils/image_utils.hpp"
+#include "utils/label_map.hpp"
+#include "utils/local_statistics.hpp"
+#include "utils/progress.hpp"
+#include <vector>
+#include <memory>
+
+namespace ic {
+
+// What a segmentation backend is asked to do: the image plus the
+// compressor options that shape regions. Backends ignore options they have
+// no equivalent for.
+struct SegmentationRequest {
+    const Image* image = nullptr;
+    std::shared_ptr<const LocalStatistics> localStats;   // shared integral images, null unless asked for
+    double similarityThreshold = 0.9;
+    int maxRegionSize = 0;                               // 0 = unlimited
+    bool adaptiveMode = true;
+    bool runningMean = false;
+    Connectivity connectivity = Connectivity::EIGHT;
+    DistanceMode distanceMode = DistanceMode::DIRECT;
+    int threadCount = 1;                                 // host threads the backend may use, 0 = all
+    ProgressCounters* progress = nullptr;                // bump as pixels get labeled, may be null
+};
+
+// The segmentation stage of ImageCompressor behind an interface, so
+// another implementation (a GPU union-find or tiled grower, say) can
+// replace the built-in algorithms without changing callers. Merging,
+// statistics and encoding stay in the compressor.
+class SegmentationBackend {
+public:
+    virtual ~SegmentationBackend() = default;
+
+    // Short name for reports and errors
+    virtual const char* name() const = 0;
+
+    // Whether segment() reads request.localStats in adaptive mode; the
+    // integral images are only built for backends that do
+    virtual bool usesLocalStatistics() const { return false; }
+
+    // Label every pixel with a dense region id and return the average
+    // color and size of each id. labels arrives reset to the image size.
+    // Called from one thread at a time; returns false on failure.
+    virtual bool segment(const SegmentationRequest& request, LabelMap& labels,
+                         std::vector<Color>& regionColors, std::vector<int>& regionSizes) = 0;
+};
+
+} // namespace ic
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "algorithms/region_grower.hpp"
+#include "algorithms/segmentation_backend.hpp"
+#include "utils/image_utils.hpp"
+#include "utils/color_tables.hpp"
+#include "utils/label_map.hpp"
+#include <vector>
+
+namespace ic {
+
+// Single-pass segmentation of a whole image. Pixels are visited in raster
+// order and joined to the components of their already visited neighbors
+// (W and N, plus NW and NE for 8-connectivity) with a union-find structure,
+// so every pixel is looked at once and the run time is near-linear.
+class UnionFindSegmenter {
+public:
+    // maxRegionSize > 0 refuses unions that would exceed that many pixels
+    UnionFindSegmenter(const Image& image, double similarityThreshold, int maxRegionSize = 0);
+
+    // Compare component means instead of neighboring pixels, which bounds
+    // the color drift along gradients [default: off]
+    void setRunningMean(bool enabled) { runningMean_ = enabled; }
+
+    void setConnectivity(Connectivity connectivity) { connectivity_ = connectivity; }
+    void setDistanceMode(DistanceMode mode) { distanceMode_ = mode; }
+
+    // Label every pixel with a dense region id (in raster order of first
+    // appearance) and return the average color and size of each region
+    void segment(LabelMap& labels, std::vector<Color>& regionColors, std::vector<int>& regionSizes);
+
+private:
+    const Image& image_;
+    double similarityThreshold_;
+    int maxRegionSize_;
+    bool runningMean_ = false;
+    Connectivity connectivity_ = Connectivity::EIGHT;
+    DistanceMode distanceMode_ = DistanceMode::DIRECT;
+
+    template <Connectivity C, typename Similar>
+    void labelPixels(LabelMap& labels, std::vector<Color>& regionColors, std::vector<int>& regionSizes,
+                     Similar similar);
+};
+
+// UnionFindSegmenter as a segmentation backend; the compressor's union-find
+// algorithm runs through it
+class UnionFindBackend final : public SegmentationBackend {
+public:
+    const char* name() const override { return "unionfind"; }
+
+    bool segment(const SegmentationRequest& request, LabelMap& labels,
+                 std::vector<Color>& regionColors, std::vector<int>& regionSizes) override;
+};
+
+} // namespace ic
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "image_compressor.hpp"
+#include <vector>
+#include <string>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <unordered_map>
+
+namespace ic {
+
+// Settings for a batch run
+struct BatchOptions {
+    int decodeWorkers = 2;
+    int compressWorkers = 0;       // 0 = number of hardware threads
+    int encodeWorkers = 2;
+    size_t queueDepth = 4;         // capacity of each queue between stages
+    std::string outputDir;         // empty = next to each input file
+    std::string outputSuffix = "_compressed";
+    std::string outputExtension;   // e.g. ".icr"; empty = the input's
+    int rawWidth = 0;              // dimensions of headerless .raw/.rgb inputs
+    int rawHeight = 0;
+    bool reportOnly = false;       // compress and report only; nothing is written
+};
+
+// Aggregate statistics across all images of a batch
+class BatchStats {
+public:
+    // Resets all counters
+    void start();
+    void finish();
+
+    // Thread-safe
+    void addImage(int64_t pixels, int regions, double latencySeconds);
+    void addFailure();
+
+    int getImageCount() const { return static_cast<int>(latencies_.size()); }
+    int getFailureCount() const { return failures_; }
+
+    // Get a dictionary of stats for reporting
+    std::unordered_map<std::string, double> getSummary() const;
+
+    // Print a formatted report
+    void printReport() const;
+
+private:
+    std::chrono::time_point<std::chrono::high_resolution_clock> startTime_;
+    std::chrono::time_point<std::chrono::high_resolution_clock> endTime_;
+    mutable std::mutex mutex_;
+
+    int64_t totalPixels_ = 0;
+    int64_t totalRegions_ = 0;
+    int failures_ = 0;
+    std::vector<double> latencies_;
+
+    double percentile(double fraction) const;
+};
+
+// Compresses many images with a three-stage pipeline: decode workers,
+// compression workers and encode/write workers joined by bounded queues,
+// so disk I/O, decoding and region growing overlap.
+class BatchProcessor {
+public:
+    // Called once per compression worker; each worker reuses its compressor
+    using CompressorFactory = std::function<std::unique_ptr<ImageCompressor>()>;
+
+    BatchProcessor(CompressorFactory factory, BatchOptions options = BatchOptions());
+
+    // Image files (by extension, raw RGB included) directly inside a
+    // directory, sorted by name
+    static std::vector<std::string> listImages(const std::string& directory);
+
+    // Process all inputs; returns true if every image succeeded
+    bool run(const std::vector<std::string>& inputs);
+
+    const BatchStats& getStats() const { return stats_; }
+
+private:
+    CompressorFactory factory_;
+    BatchOptions options_;
+    BatchStats stats_;
+    std::mutex logMutex_;
+
+    std::string outputPathFor(const std::string& inputPath) const;
+    void log(const std::string& message);
+};
+
+} // namespace ic
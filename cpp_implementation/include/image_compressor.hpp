@@ -2,11 +2,23 @@
 
 #include "utils/image_utils.hpp"
 #include "algorithms/region_grower.hpp"
+#include "algorithms/seed_scheduler.hpp"
+#include "algorithms/segmentation_backend.hpp"
+#include "utils/metrics.hpp"
+#include "utils/progress.hpp"
+#include "utils/region_graph.hpp"
+#include "utils/region_sums.hpp"
+#include "utils/result_cache.hpp"
+#include "utils/thread_pool.hpp"
 #include <vector>
 #include <string>
 #include <functional>
 #include <chrono>
 #include <memory>
+#include <future>
+#include <unordered_map>
+#include <limits>
+#include <cstdint>
 
 namespace ic {
 
@@ -18,6 +30,43 @@ public:
     void start(int width, int height);
     void finish();
     void addRegion(const std::vector<Point>& region);
+    void addRegion(int regionSize);
+    
+    // Replace the recorded region sizes (e.g. after merging tile regions);
+    // the processed-pixel count becomes their sum
+    void setRegionSizes(std::vector<int> regionSizes);
+    
+    // Record work done by one worker thread in parallel mode
+    void addThreadWork(int threadIndex, int64_t pixels, double busySeconds);
+    
+    // Record similarity cache effectiveness
+    void setCacheStats(uint64_t hits, uint64_t misses);
+    
+    // Record pyramid mode: levels used and pixels regrown at full resolution
+    void setPyramidStats(int levels, int64_t refinedPixels);
+    
+    // Record sequence mode: frame number and pixels regrown for this frame
+    void setSequenceStats(int frame, int64_t regrownPixels);
+    
+    // Record the merge passes: regions folded into a neighbor for being
+    // under the minimum size, and by the region-count/color-delta target
+    void setMergedRegions(int smallMerges, int targetMerges) {
+        smallMerges_ = smallMerges;
+        targetMerges_ = targetMerges;
+    }
+    
+    // Record the size cap in effect (0 = unlimited) and how many regions
+    // stopped at it
+    void setRegionSizeCap(int cap, int64_t truncatedRegions);
+    
+    // Record a result cache lookup
+    void setResultCacheHit(bool hit) { resultCacheState_ = hit ? 1 : 0; }
+    
+    // Phase timers and counters recorded while this job ran (see
+    // utils/metrics.hpp); they're process-wide, so jobs running concurrently
+    // in batch mode share them
+    void setMetrics(const metrics::Snapshot& snapshot) { metrics_ = snapshot; }
+    const metrics::Snapshot& getMetrics() const { return metrics_; }
     
     double getElapsedTime() const;
     double getProgress() const;
@@ -29,13 +78,18 @@ public:
     // Print a formatted report
     void printReport() const;
     
+    // Detailed summary plus phase metrics as one JSON object
+    void writeJson(std::ostream& out) const;
+    
 private:
     std::chrono::time_point<std::chrono::high_resolution_clock> startTime_;
     std::chrono::time_point<std::chrono::high_resolution_clock> endTime_;
     bool finished_ = false;
     
-    int totalPixels_ = 0;
-    int processedPixels_ = 0;
+    int width_ = 0;
+    int height_ = 0;
+    int64_t totalPixels_ = 0;
+    int64_t processedPixels_ = 0;
     int totalRegions_ = 0;
     int largestRegion_ = 0;
     int smallestRegion_ = std::numeric_limits<int>::max();
@@ -45,12 +99,40 @@ private:
     int64_t bytesOriginal_ = 0;
     int64_t bytesCompressed_ = 0;
     
+    uint64_t cacheHits_ = 0;
+    uint64_t cacheMisses_ = 0;
+    
+    int pyramidLevels_ = 0;
+    int64_t refinedPixels_ = 0;
+    
+    int sequenceFrame_ = -1;
+    int64_t regrownPixels_ = 0;
+    
+    int smallMerges_ = 0;
+    int targetMerges_ = 0;
+    
+    int regionSizeCap_ = 0;
+    int64_t truncatedRegions_ = 0;
+    
+    int resultCacheState_ = -1;     // -1 no cache, 0 miss, 1 hit
+    
+    // Per-thread work in parallel mode
+    struct ThreadWork {
+        int64_t pixels = 0;
+        double busySeconds = 0.0;
+    };
+    std::vector<ThreadWork> threadWork_;
+    
+    metrics::Snapshot metrics_;
+    
     // Helper for formatting byte sizes
     std::string formatBytes(int64_t bytes) const;
     std::string formatTime(double seconds) const;
 };
 
-// Callback type for progress updates
+// Callback type for progress updates. It runs on a reporter thread, once
+// per progress interval and once more when the job ends (see ProgressSink
+// for the same data without building a map).
 using ProgressCallback = std::function<void(double progress, const std::unordered_map<std::string, double>& stats)>;
 
 // Main compressor class
@@ -58,49 +140,316 @@ class ImageCompressor {
 public:
     enum class Algorithm {
         ADAPTIVE,
-        MEAN_SHIFT
+        MEAN_SHIFT,
+        UNION_FIND     // single raster pass, speed over quality
     };
     
+    static constexpr int kUnlimitedRegionSize = 0;
+    static constexpr int kAutoRegionSize = -1;
+    
+    // Cap used for kAutoRegionSize: a twentieth of the image but at least
+    // kMinAutoRegionSize pixels, lowered if growing a region that large
+    // would need more than a quarter of the available memory
+    static int autoMaxRegionSize(int width, int height);
+    static constexpr int kMinAutoRegionSize = 10000;
+    
+    // maxRegionSize: pixels per region at most; kUnlimitedRegionSize (0)
+    // never caps, kAutoRegionSize picks a cap per image (autoMaxRegionSize)
     ImageCompressor(double similarityThreshold = 0.9, 
-                   int maxRegionSize = 0,
+                   int maxRegionSize = kUnlimitedRegionSize,
                    ProgressCallback progressCallback = nullptr,
                    Algorithm algorithm = Algorithm::ADAPTIVE,
                    bool adaptiveMode = true);
     
+    // Stage threads reference the compressor, so it stays where it is
+    ImageCompressor(const ImageCompressor&) = delete;
+    ImageCompressor& operator=(const ImageCompressor&) = delete;
+    
+    // The three stages, synchronously: decode (loadImage/setImage),
+    // segment (compress) and encode (saveCompressedImage)
+    
+    // Decode an image file, or map raw RGB when both raw dimensions are
+    // given; null (with a message on stderr) on failure
+    static std::shared_ptr<Image> decodeImage(const std::string& imagePath, int rawWidth = 0, int rawHeight = 0);
+    
     // Load an image from file
     bool loadImage(const std::string& imagePath);
     
+    // Use an already decoded image
+    void setImage(std::shared_ptr<Image> image);
+    
     // Compress the loaded image
     bool compress();
     
-    // Save the compressed image
+    // Save the compressed image; a .icr path writes the native region map
     bool saveCompressedImage(const std::string& outputPath);
     
+    // Options a result is written with (algorithm and threshold go into
+    // the metadata report)
+    struct OutputSettings {
+        Algorithm algorithm;
+        double similarityThreshold;
+        bool adaptiveMode;
+        bool entropyCoding;
+    };
+    
+    // A finished compression copied out of the compressor, so another
+    // thread can write it while the compressor takes the next image
+    struct Result {
+        std::shared_ptr<Image> image;
+        LabelMap labels;
+        std::vector<Color> regionColors;
+        CompressionStats stats;
+        OutputSettings settings;
+    };
+    
+    // Copy of the last compression; false (with a message) without one
+    bool copyResult(Result& result) const;
+    
+    // Write a result as saveCompressedImage does, metadata report included,
+    // without printing the file size or touching any compressor
+    static bool saveResult(const Result& result, const std::string& outputPath);
+    
+    // The same stages asynchronously. Each kind of stage has one thread of
+    // its own and runs its jobs in call order, so one image's encode can
+    // overlap the next image's segmentation and the one after's decode.
+    // A callback runs on the stage thread just before its future is ready.
+    // Call these from one thread, and leave the compressor's results and
+    // setters alone until every segmentAsync queued so far has finished.
+    using DecodeCallback = std::function<void(std::shared_ptr<Image> image)>;
+    using StageCallback = std::function<void(bool ok)>;
+    
+    // decodeImage on the decode thread; touches no compressor state
+    std::future<std::shared_ptr<Image>> decodeAsync(const std::string& imagePath, DecodeCallback done = nullptr,
+                                                    int rawWidth = 0, int rawHeight = 0);
+    
+    // setImage(image) and compress() on the segment thread
+    std::future<bool> segmentAsync(std::shared_ptr<Image> image, StageCallback done = nullptr);
+    
+    // Encode the result of the last segmentation queued before this call:
+    // it's copied on the segment thread once that segmentation is done, then
+    // written on the encode thread while the compressor moves on. Unlike
+    // saveCompressedImage, stats keep no encode metrics and no file size is
+    // printed.
+    std::future<bool> encodeAsync(const std::string& outputPath, StageCallback done = nullptr);
+    
+    // Build the compressed image (every region filled with its average color)
+    Image renderCompressedImage() const;
+    
+    // The output saveCompressedImage would write for a file extension
+    // ("icr" for the region map, or png, jpg, bmp, ppm, rgb), in memory and
+    // without the metadata report
+    bool encodeCompressedImage(const std::string& extension, std::vector<uint8_t>& out) const;
+    
+    // Entropy-code the label map of .icr output [default: on]
+    void setEntropyCoding(bool enabled) { entropyCoding_ = enabled; }
+    
+    // Structured progress samples, delivered alongside the callback
+    void setProgressSink(ProgressSink sink) { progressSink_ = std::move(sink); }
+    
+    // Seconds between progress samples [default: 0.5]
+    void setProgressInterval(double seconds) { progressUpdateInterval_ = seconds; }
+    
+    // Print the statistics report at the end of compress() [default: on]
+    void setReportEnabled(bool enabled) { reportEnabled_ = enabled; }
+    
+    // Number of slots in the grower's similarity cache (0 disables it)
+    void setSimilarityCacheSize(size_t entries) { similarityCacheEntries_ = entries; }
+    
+    // Direct double-precision similarity or precomputed squared-distance tables
+    void setDistanceMode(DistanceMode mode) { distanceMode_ = mode; }
+    
+    // 4- or 8-connected region growth
+    void setConnectivity(Connectivity connectivity) { connectivity_ = connectivity; }
+    
+    // Binary heap or quantized bucket queue for the region frontier
+    void setFrontierMode(FrontierMode mode) { frontierMode_ = mode; }
+    
+    // Union-find: compare component means rather than neighboring pixels
+    void setRunningMean(bool enabled) { runningMean_ = enabled; }
+    
+    // Radius of the window used for adaptive thresholding
+    void setAdaptiveRadius(int radius) { adaptiveRadius_ = radius; }
+    
+    // Order in which serial and tiled growth try seeds. GRADIENT and GRID
+    // start regions in flat areas, so fewer slivers grow along edges.
+    // [default: raster]
+    void setSeedOrder(SeedOrder order) { seedOrder_ = order; }
+    
+    // Merge regions smaller than this into their most similar neighbor after
+    // segmentation, using the region adjacency graph; the size cap still
+    // applies. 0 or 1 disables [default: 0]
+    void setMinRegionSize(int pixels) { minRegionSize_ = pixels; }
+    
+    // Rate control: after segmentation (and the small-region pass), merge
+    // the closest-colored adjacent regions on the region graph until the
+    // target region count or color delta is reached [default: off]
+    void setMergeTarget(const MergeTarget& target) { mergeTarget_ = target; }
+    
+    // Coarse-to-fine mode for the adaptive algorithm: segment a copy
+    // downsampled `levels` times (each halving), project its regions back,
+    // and regrow at full resolution only along coarse region boundaries and
+    // in detailed blocks. 0 disables [default: 0]. Runs serially.
+    void setPyramidLevels(int levels) { pyramidLevels_ = levels; }
+    
+    // Sequence mode for video frames: each setImage/loadImage keeps the
+    // previous frame's labels and region colors, and compress() diffs the
+    // new frame against it in kSequenceBlockSize blocks. Regions keep their
+    // unchanged pixels (and their ids); only changed blocks and a one-block
+    // border are regrown and stitched back. The first frame, a size change,
+    // a non-adaptive algorithm or a zone covering most of the frame
+    // compresses the whole frame. [default: off]
+    void setSequenceMode(bool enabled);
+    
+    static constexpr int kSequenceBlockSize = 16;
+    
+    // Parallel tiled mode: used when threadCount != 1 (0 = all hardware
+    // threads) or a tile size is set; tileSize 0 picks kDefaultTileSize
+    void setThreadCount(int threadCount) { threadCount_ = threadCount; }
+    void setTileSize(int tileSize) { tileSize_ = tileSize; }
+    
+    static constexpr int kDefaultTileSize = 256;
+    
+    // Replace the built-in algorithms with another segmentation backend
+    // (null restores them). Small-region and target merges still apply;
+    // pyramid and sequence updates need the built-in adaptive grower and
+    // are skipped. [default: built-in]
+    void setSegmentationBackend(std::shared_ptr<SegmentationBackend> backend) { backend_ = std::move(backend); }
+    
+    // Look results up in an on-disk cache before segmenting, and store
+    // them after a miss; keyed by the image's pixels and every option that
+    // changes the output. Sequence updates bypass it. May be shared by
+    // several compressors. [default: none]
+    void setResultCache(std::shared_ptr<ResultCache> cache) { resultCache_ = std::move(cache); }
+    
+    // Statistics of the last compression
+    const CompressionStats& getStats() const { return stats_; }
+    
+    // Per-pixel region ids and the average color of each region
+    const LabelMap& getLabelMap() const { return labels_; }
+    const std::vector<Color>& getRegionColors() const { return regionColors_; }
+    
 private:
     double similarityThreshold_;
     int maxRegionSize_;
+    // maxRegionSize_ resolved for the current image (0 = unlimited)
+    int regionSizeCap_ = 0;
+    // Regions stopped by regionSizeCap_ in the current compress()
+    int64_t truncatedRegions_ = 0;
     ProgressCallback progressCallback_;
+    ProgressSink progressSink_;
     Algorithm algorithm_;
     bool adaptiveMode_;
+    size_t similarityCacheEntries_ = SimilarityCache::kDefaultEntries;
+    DistanceMode distanceMode_ = DistanceMode::DIRECT;
+    Connectivity connectivity_ = Connectivity::EIGHT;
+    FrontierMode frontierMode_ = FrontierMode::HEAP;
+    bool runningMean_ = false;
+    int adaptiveRadius_ = AdaptiveRegionGrower::kDefaultAdaptiveRadius;
+    int threadCount_ = 1;
+    int tileSize_ = 0;
+    int pyramidLevels_ = 0;
+    SeedOrder seedOrder_ = SeedOrder::RASTER;
+    int minRegionSize_ = 0;
+    MergeTarget mergeTarget_;
+    bool sequenceMode_ = false;
+    int sequenceFrame_ = 0;
+    bool reportEnabled_ = true;
+    bool entropyCoding_ = true;
+    std::shared_ptr<SegmentationBackend> backend_ = nullptr;
+    std::shared_ptr<ResultCache> resultCache_ = nullptr;
     
     // Image data
     std::shared_ptr<Image> image_ = nullptr;
     int width_ = 0;
     int height_ = 0;
     
-    // Compression results
-    std::vector<std::vector<Point>> regions_;
+    // Integral images for O(1) local variance, built on demand once per
+    // image (only adaptive thresholds and the pyramid's detail test use them)
+    std::shared_ptr<const LocalStatistics> localStats_ = nullptr;
+    
+    // Gradient magnitudes for the non-raster seed orders, built on demand
+    std::shared_ptr<const GradientMap> gradient_ = nullptr;
+    
+    // Downsampled copies for pyramid mode, finest first
+    std::vector<Image> pyramid_;
+    
+    // Sequence mode: the frame labels_ currently describes, and the channel
+    // sums of every region id (empty ids are dead until compacted)
+    std::shared_ptr<Image> previousFrame_ = nullptr;
+    std::vector<RegionSums> regionSums_;
+    
+    // Compression results: region id per pixel, color per region
+    LabelMap labels_;
     std::vector<Color> regionColors_;
     
     // Statistics
     CompressionStats stats_;
     
-    // Last progress update time
-    std::chrono::time_point<std::chrono::high_resolution_clock> lastProgressUpdate_;
+    // Metric totals when the current image was loaded
+    metrics::Snapshot metricsBaseline_;
+    
+    // Progress bumped by workers and sampled by a ProgressReporter
+    ProgressCounters progress_;
     double progressUpdateInterval_ = 0.5; // seconds
     
-    // Update progress display
-    void updateProgress(bool force = false);
+    OutputSettings outputSettings() const;
+    
+    // Sink feeding progressSink_ and progressCallback_; null if neither is set
+    ProgressSink createProgressSink() const;
+    
+    // Create a region grower configured with the current options, for the
+    // loaded image or for another (e.g. a pyramid level)
+    std::unique_ptr<AdaptiveRegionGrower> createGrower();
+    std::unique_ptr<AdaptiveRegionGrower> createGrower(const Image& image,
+                                                       std::shared_ptr<const LocalStatistics> localStats,
+                                                       int maxRegionSize) const;
+    std::unique_ptr<MeanShiftSegmenter> createSegmenter() const;
+    
+    // Seed scheduler for seedOrder_ (builds gradient_ when it needs one)
+    std::unique_ptr<SeedScheduler> createSeedScheduler();
+
+    // The current image's local statistics, building them on first use
+    std::shared_ptr<const LocalStatistics> localStatistics();
+    
+    // Compression with a single region finder; templated on the (final)
+    // grower type so appendRegion is called directly
+    template <typename Grower>
+    void compressSerial(Grower& regionFinder);
+    
+    // Grow regions per tile on a worker pool, then stitch across tile edges
+    void compressTiled();
+    
+    // Small-region and target merges on the region adjacency graph
+    void mergeRegions();
+    
+    // Result cache key for the current image and options, and the lookup
+    // that fills labels_ and regionColors_ on a hit
+    ResultCache::Key resultCacheKey() const;
+    bool loadCachedResult(const ResultCache::Key& key);
+    
+    // Segment through a backend (union-find is one), checking its labels
+    bool compressWithBackend(SegmentationBackend& backend);
+    
+    // Segment the coarsest pyramid level, project, regrow the uncertain parts
+    void buildPyramid();
+    void compressPyramid();
+    
+    // Sequence mode: the blocks that changed since previousFrame_ plus a
+    // one-block border, and regrowing only those
+    std::vector<Rect> changedZone() const;
+    void compressIncremental(const std::vector<Rect>& zone);
+    void rebuildRegionSums();
+    void compactRegions();
+    
+    // Stage threads for the async variants, created on first use. Declared
+    // last so they drain first on destruction; the segment thread hands
+    // work to the encode thread, so it goes before that.
+    std::unique_ptr<ThreadPool> decodeStage_;
+    std::unique_ptr<ThreadPool> encodeStage_;
+    std::unique_ptr<ThreadPool> segmentStage_;
+    
+    static ThreadPool& stageThread(std::unique_ptr<ThreadPool>& stage);
 };
 
 } // namespace ic
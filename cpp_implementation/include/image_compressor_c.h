@@ -0,0 +1,77 @@
+#pragma once
+
+/* C interface to libimagecompressor: compress an RGB buffer in memory into
+ * an encoded buffer in memory, with no files involved. A compressor handle
+ * keeps its buffers between calls; use one handle per thread. */
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ic_compressor ic_compressor;
+
+typedef enum {
+    IC_ALGORITHM_ADAPTIVE = 0,
+    IC_ALGORITHM_MEAN_SHIFT = 1,
+    IC_ALGORITHM_UNION_FIND = 2
+} ic_algorithm;
+
+typedef enum {
+    IC_FORMAT_REGION_MAP = 0,   /* native .icr: palette plus coded label map */
+    IC_FORMAT_RGB = 1,          /* bare interleaved RGB, width * height * 3 bytes */
+    IC_FORMAT_PPM = 2,
+    IC_FORMAT_PNG = 3,
+    IC_FORMAT_JPEG = 4,
+    IC_FORMAT_BMP = 5
+} ic_format;
+
+typedef enum {
+    IC_OK = 0,
+    IC_ERROR_INVALID_ARGUMENT = 1,
+    IC_ERROR_COMPRESSION = 2,
+    IC_ERROR_ENCODING = 3,
+    IC_ERROR_OUT_OF_MEMORY = 4
+} ic_status;
+
+/* Fill with ic_options_init before changing fields */
+typedef struct {
+    double similarity_threshold;   /* 0.0-1.0 [0.9] */
+    int max_region_size;           /* pixels; 0 = unlimited, -1 = auto [0] */
+    ic_algorithm algorithm;        /* [IC_ALGORITHM_ADAPTIVE] */
+    int adaptive;                  /* nonzero: adaptive thresholding [1] */
+    int threads;                   /* 1 = serial, 0 = all hardware threads [1] */
+    int min_region_size;           /* merge smaller regions; 0 = off [0] */
+    int entropy_coding;            /* entropy-code the region map [1] */
+} ic_options;
+
+/* Encoded output, allocated by the library; release with ic_buffer_free */
+typedef struct {
+    unsigned char* data;
+    size_t size;
+} ic_buffer;
+
+void ic_options_init(ic_options* options);
+
+/* NULL if an option is out of range or memory runs out */
+ic_compressor* ic_compressor_create(const ic_options* options);
+void ic_compressor_destroy(ic_compressor* compressor);
+
+/* Compress width x height pixels of interleaved RGB whose rows are stride
+ * bytes apart (0 = width * 3) and encode the result as format into output.
+ * The pixels are copied, so rgb may be reused as soon as this returns. */
+ic_status ic_compress_rgb(ic_compressor* compressor, const unsigned char* rgb, int width, int height,
+                          size_t stride, ic_format format, ic_buffer* output);
+
+/* Regions found by the last successful ic_compress_rgb */
+size_t ic_region_count(const ic_compressor* compressor);
+
+/* What went wrong in the last failed call, or "" */
+const char* ic_last_error(const ic_compressor* compressor);
+
+void ic_buffer_free(ic_buffer* buffer);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "image_compressor.hpp"
+#include "utils/row_io.hpp"
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace ic {
+
+// Settings for strip-wise compression
+struct StreamingOptions {
+    int stripHeight = 64;              // rows decoded and labeled at a time
+    double similarityThreshold = 0.9;
+    int maxRegionSize = 0;             // 0 = no cap
+    bool runningMean = false;          // compare component means (see UnionFindSegmenter)
+    Connectivity connectivity = Connectivity::EIGHT;
+    DistanceMode distanceMode = DistanceMode::DIRECT;
+    double progressInterval = 0.5;     // seconds between progress samples
+};
+
+// Compresses images too large to hold in memory. Strips of rows are read
+// from a RowReader and labeled with the union-find raster scan; only the
+// current strip plus the components still touching its last row are kept.
+// Regions that can no longer grow are finalized at the end of each strip
+// and their labels spilled to a temporary file, which a second pass turns
+// into the output rows. Peak memory is O(strip height * width), plus three
+// bytes per region for the palette and, until the second pass, the final
+// codes of the components carried across each seam: at most one 4-byte
+// entry per column per strip, width * height / strip height in all.
+class StreamingCompressor {
+public:
+    explicit StreamingCompressor(StreamingOptions options = StreamingOptions(),
+                                 ProgressSink progressSink = nullptr);
+
+    // Compress input and write the rendered result (PPM, or raw RGB for a
+    // .raw/.rgb path). Returns false on failure, with the reason on stderr.
+    bool run(RowReader& input, const std::string& outputPath);
+
+    const CompressionStats& getStats() const { return stats_; }
+
+    // Largest number of components carried from one strip to the next
+    size_t getPeakActiveRegions() const { return peakActiveRegions_; }
+
+private:
+    StreamingOptions options_;
+    ProgressSink progressSink_;
+    ProgressCounters progress_;     // pixels labeled, regions finalized
+    CompressionStats stats_;
+    size_t peakActiveRegions_ = 0;
+
+    bool runPasses(RowReader& input, const std::string& outputPath, const std::string& spillPath);
+
+    template <Connectivity C, typename Similar>
+    bool labelStrips(RowReader& input, std::fstream& spill, std::vector<Color>& palette,
+                     std::vector<std::vector<uint32_t>>& forward, Similar similar);
+};
+
+} // namespace ic
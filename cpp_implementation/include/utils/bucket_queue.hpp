@@ -0,0 +1,108 @@
+#pragma once
+
+#include "utils/label_map.hpp"
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+
+namespace ic {
+
+// Priority queue of item indices (e.g. pixels) with a small range of integer
+// priorities. Push and decrease-key are O(1); pop scans forward from the
+// lowest bucket that may be non-empty, so it's amortized O(1) over a run.
+// Every item is queued at most once: pushing an item that's already queued
+// only moves it when the new priority is lower.
+class BucketQueue {
+public:
+    // 1/1024 steps over [0, 1]
+    static constexpr uint32_t kDefaultBuckets = 1025;
+
+    explicit BucketQueue(uint32_t bucketCount = kDefaultBuckets)
+        : buckets_(std::max<uint32_t>(bucketCount, 1)), cursor_(static_cast<uint32_t>(buckets_.size())) {}
+
+    uint32_t bucketCount() const { return static_cast<uint32_t>(buckets_.size()); }
+
+    // Accept item indices in [0, itemCount); clears the queue
+    void resize(size_t itemCount) {
+        clear();
+        position_.resize(itemCount);
+        bucketOf_.resize(itemCount);
+        queued_.resize(itemCount);
+    }
+
+    size_t capacity() const { return queued_.size(); }
+
+    // Remove every item
+    void clear() {
+        for (uint32_t b = cursor_; b < buckets_.size() && size_ > 0; ++b) {
+            size_ -= buckets_[b].size();
+            buckets_[b].clear();
+        }
+        size_ = 0;
+        cursor_ = bucketCount();
+        queued_.nextGeneration();
+    }
+
+    bool empty() const { return size_ == 0; }
+    size_t size() const { return size_; }
+
+    bool contains(uint32_t item) const { return queued_.test(item); }
+
+    // Queue item with the given priority (clamped to the last bucket), or
+    // lower its priority if it's already queued. Returns false if the item
+    // was already queued at an equal or lower priority.
+    bool push(uint32_t item, uint32_t bucket) {
+        bucket = std::min(bucket, bucketCount() - 1);
+        if (queued_.test(item)) {
+            if (bucket >= bucketOf_[item]) {
+                return false;
+            }
+            remove(item);
+        }
+        else {
+            queued_.mark(item);
+        }
+
+        position_[item] = static_cast<uint32_t>(buckets_[bucket].size());
+        bucketOf_[item] = bucket;
+        buckets_[bucket].push_back(item);
+        cursor_ = std::min(cursor_, bucket);
+        ++size_;
+        return true;
+    }
+
+    // Remove and return an item with the lowest priority (last in, first
+    // out among equals). The queue must not be empty.
+    uint32_t pop() {
+        while (buckets_[cursor_].empty()) {
+            ++cursor_;
+        }
+        std::vector<uint32_t>& bucket = buckets_[cursor_];
+        uint32_t item = bucket.back();
+        bucket.pop_back();
+        --size_;
+        queued_.unmark(item);
+        return item;
+    }
+
+private:
+    std::vector<std::vector<uint32_t>> buckets_;
+    std::vector<uint32_t> position_;   // index of each queued item in its bucket
+    std::vector<uint32_t> bucketOf_;   // bucket of each queued item
+    VisitedBuffer queued_;
+    uint32_t cursor_;                  // no bucket below this is non-empty
+    size_t size_ = 0;
+
+    // Swap-remove a queued item from its bucket
+    void remove(uint32_t item) {
+        std::vector<uint32_t>& bucket = buckets_[bucketOf_[item]];
+        uint32_t last = bucket.back();
+        bucket[position_[item]] = last;
+        position_[last] = position_[item];
+        bucket.pop_back();
+        --size_;
+    }
+};
+
+} // namespace ic
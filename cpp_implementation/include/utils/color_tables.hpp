@@ -0,0 +1,42 @@
+#pragma once
+
+#include "utils/image_utils.hpp"
+#include <cstdint>
+
+namespace ic {
+
+// How region growers evaluate color similarity
+enum class DistanceMode {
+    DIRECT,  // colorSimilarity() in double precision
+    TABLE    // per-channel squared-delta tables, thresholds in squared space
+};
+
+// Largest possible squared RGB distance (3 * 255^2)
+constexpr int32_t kMaxSquaredDistance = 195075;
+
+// Per-channel squared-delta lookup tables. For 8-bit channels the delta only
+// has 511 possible values, so comparisons reduce to three loads and two adds.
+// Thresholds are settled with the same expression as the double path, which
+// keeps table mode bit-for-bit identical to colorSimilarity().
+class ColorTables {
+public:
+    static const ColorTables& instance();
+
+    // Integer squared Euclidean distance (exact)
+    int32_t squaredDistance(const Color& c1, const Color& c2) const {
+        return squared_[c1.r - c2.r + 255] + squared_[c1.g - c2.g + 255] + squared_[c1.b - c2.b + 255];
+    }
+
+    // Largest squared distance for which colorSimilarity() >= threshold (-1 if none)
+    static int32_t similarityToSquaredThreshold(double threshold);
+
+private:
+    ColorTables();
+
+    int32_t squared_[511];
+};
+
+// colorSimilarity() expressed on an already computed squared distance
+double similarityFromSquaredDistance(int32_t squaredDistance);
+
+} // namespace ic
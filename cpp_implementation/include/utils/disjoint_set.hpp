@@ -0,0 +1,63 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <numeric>
+#include <utility>
+
+namespace ic {
+
+// Union-find over dense uint32 ids with path halving and union by size
+class DisjointSet {
+public:
+    DisjointSet() = default;
+    explicit DisjointSet(size_t count) { reset(count); }
+
+    void reset(size_t count) {
+        parent_.resize(count);
+        std::iota(parent_.begin(), parent_.end(), 0u);
+        size_.assign(count, 1);
+    }
+
+    // Add a new singleton set and return its id
+    uint32_t add() {
+        uint32_t id = static_cast<uint32_t>(parent_.size());
+        parent_.push_back(id);
+        size_.push_back(1);
+        return id;
+    }
+
+    size_t count() const { return parent_.size(); }
+
+    uint32_t find(uint32_t id) {
+        while (parent_[id] != id) {
+            parent_[id] = parent_[parent_[id]];
+            id = parent_[id];
+        }
+        return id;
+    }
+
+    // Merge the sets of a and b; returns the surviving root
+    uint32_t unite(uint32_t a, uint32_t b) {
+        a = find(a);
+        b = find(b);
+        if (a == b) {
+            return a;
+        }
+        if (size_[a] < size_[b]) {
+            std::swap(a, b);
+        }
+        parent_[b] = a;
+        size_[a] += size_[b];
+        return a;
+    }
+
+    // Number of ids in the set containing id
+    uint32_t setSize(uint32_t id) { return size_[find(id)]; }
+
+private:
+    std::vector<uint32_t> parent_;
+    std::vector<uint32_t> size_;
+};
+
+} // namespace ic
@@ -6,6 +6,7 @@
 #include <memory>
 #include <tuple>
 #include <functional> // For std::hash
+#include <type_traits>
 
 namespace ic {
 
@@ -36,6 +37,11 @@ struct Color {
     }
 };
 
+// Color must match the interleaved 8-bit RGB layout used by stb_image so
+// pixel buffers can be shared without conversion
+static_assert(sizeof(Color) == 3 && alignof(Color) == 1, "Color must be packed RGB");
+static_assert(std::is_trivially_copyable<Color>::value, "Color must be trivially copyable");
+
 // Simple point structure
 struct Point {
     int x, y;
@@ -53,6 +59,38 @@ struct Point {
     }
 };
 
+// Axis-aligned rectangle of pixels
+struct Rect {
+    int x, y, width, height;
+    
+    Rect() : x(0), y(0), width(0), height(0) {}
+    Rect(int x, int y, int width, int height) : x(x), y(y), width(width), height(height) {}
+    
+    bool contains(int px, int py) const {
+        return px >= x && px < x + width && py >= y && py < y + height;
+    }
+    
+    size_t area() const { return static_cast<size_t>(width) * height; }
+};
+
+// Non-owning view of a contiguous run of elements (e.g. one image row)
+template <typename T>
+class Span {
+public:
+    Span() : data_(nullptr), size_(0) {}
+    Span(T* data, size_t size) : data_(data), size_(size) {}
+    
+    T* data() const { return data_; }
+    size_t size() const { return size_; }
+    T* begin() const { return data_; }
+    T* end() const { return data_ + size_; }
+    T& operator[](size_t index) const { return data_[index]; }
+    
+private:
+    T* data_;
+    size_t size_;
+};
+
 // Hash function for Points to use in unordered_set/map
 struct PointHash {
     std::size_t operator()(const Point& p) const {
@@ -64,38 +102,98 @@ struct PointHash {
 // Image class
 class Image {
 public:
+    // Releases a pixel buffer adopted by an Image
+    using BufferDeleter = std::function<void(Color*)>;
+    
     Image(int width, int height);
+    
+    // Load an image file; binary PPM is memory-mapped (see mapPpm), other
+    // formats are decoded with stb_image
     Image(const std::string& filename);
+    
+    // Use a memory-mapped PPM (P6, maxval 255) or headerless raw RGB file
+    // as the pixel buffer, with no decode and no copy. The mapping is
+    // copy-on-write: modifying the image never changes the file. Throws
+    // std::runtime_error if the file can't be mapped or is too short.
+    static Image mapPpm(const std::string& filename);
+    static Image mapRaw(const std::string& filename, int width, int height);
+    
+    // Adopt an existing interleaved RGB buffer of width * height pixels
+    // without copying; deleter is called with it when the image goes away
+    Image(int width, int height, Color* pixels, BufferDeleter deleter);
+    
+    // Copy interleaved RGB rows stride bytes apart (0 = tightly packed)
+    // from memory the caller keeps
+    static Image fromRgb(const uint8_t* rgb, int width, int height, size_t stride = 0);
+    
+    // Copies duplicate the pixels; moves transfer the buffer
+    Image(const Image& other);
+    Image& operator=(const Image& other);
+    Image(Image&& other) = default;
+    Image& operator=(Image&& other) = default;
     ~Image();
     
     // Create a new image with the same dimensions
     Image createSimilar() const;
     
-    // Save to a file
+    // Half-size copy (rounded up): each pixel is the truncated mean of the
+    // 2x2 block it covers, edge blocks repeating their last row or column
+    Image downsample() const;
+    
+    // Save to a file; .ppm and .raw/.rgb are written through a memory
+    // mapping, other extensions are encoded with stb_image_write
     bool save(const std::string& filename) const;
     
+    // The bytes save() would write for a file extension (png, jpg, bmp,
+    // ppm, or raw/rgb for bare pixels), into memory; false for others
+    bool encode(const std::string& extension, std::vector<uint8_t>& out) const;
+    
     // Get dimensions
     int getWidth() const { return width_; }
     int getHeight() const { return height_; }
     
-    // Get pixel color
+    // Get pixel color (returns black outside the image)
     Color getPixel(int x, int y) const;
     
-    // Set pixel color
+    // Set pixel color (ignored outside the image)
     void setPixel(int x, int y, const Color& color);
     
-    // Calculate average color of a set of points
+    // Unchecked access for hot loops: the caller guarantees valid coordinates
+    const Color& at(int x, int y) const { return pixels_[getIndex(x, y)]; }
+    Color& at(int x, int y) { return pixels_[getIndex(x, y)]; }
+    
+    // One row of pixels (unchecked)
+    Span<const Color> row(int y) const { return Span<const Color>(pixels_.get() + getIndex(0, y), width_); }
+    Span<Color> row(int y) { return Span<Color>(pixels_.get() + getIndex(0, y), width_); }
+    
+    // Raw interleaved RGB buffer, row-major, width * height pixels
+    const Color* data() const { return pixels_.get(); }
+    Color* data() { return pixels_.get(); }
+    size_t getPixelCount() const { return pixelCount(); }
+    
+    // Utility to convert between x,y and linear index
+    size_t getIndex(int x, int y) const {
+        return static_cast<size_t>(y) * width_ + x;
+    }
+    
+    // Calculate average color of a set of points (all inside the image)
     static Color calculateAverageColor(const std::vector<Point>& points, const Image& image);
     
 private:
     int width_;
     int height_;
-    std::vector<Color> pixels_;
+    std::unique_ptr<Color[], BufferDeleter> pixels_;
     
-    // Utility to convert between x,y and linear index
-    size_t getIndex(int x, int y) const {
-        return y * width_ + x;
-    }
+    size_t pixelCount() const { return static_cast<size_t>(width_) * height_; }
+    
+    // Allocate an owned, zero-initialized buffer
+    static std::unique_ptr<Color[], BufferDeleter> allocate(size_t count);
+    
+    // Adopt width * height pixels starting offset bytes into a mapped file
+    static Image mapPixels(const std::string& filename, size_t offset, int width, int height);
+    
+    // Write header followed by the pixels through a mapping of filename
+    bool saveMapped(const std::string& filename, const std::string& header) const;
 };
 
 // Color similarity functions
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "utils/metrics.hpp"
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+
+namespace ic {
+
+// Dense, image-sized map of region ids (one uint32 per pixel, row-major)
+class LabelMap {
+public:
+    static constexpr uint32_t kUnassigned = 0xFFFFFFFFu;
+
+    LabelMap() = default;
+    LabelMap(int width, int height) { reset(width, height); }
+
+    // Resize and mark every pixel as unassigned
+    void reset(int width, int height) {
+        width_ = width;
+        height_ = height;
+        labels_.assign(static_cast<size_t>(width) * height, kUnassigned);
+        metrics::count(metrics::Counter::BYTES_ALLOCATED, labels_.size() * sizeof(uint32_t));
+    }
+
+    int getWidth() const { return width_; }
+    int getHeight() const { return height_; }
+    size_t size() const { return labels_.size(); }
+
+    size_t index(int x, int y) const { return static_cast<size_t>(y) * width_ + x; }
+
+    uint32_t get(int x, int y) const { return labels_[index(x, y)]; }
+    void set(int x, int y, uint32_t label) { labels_[index(x, y)] = label; }
+
+    bool isAssigned(int x, int y) const { return labels_[index(x, y)] != kUnassigned; }
+    bool isAssigned(size_t idx) const { return labels_[idx] != kUnassigned; }
+
+    uint32_t operator[](size_t idx) const { return labels_[idx]; }
+    uint32_t& operator[](size_t idx) { return labels_[idx]; }
+
+    const uint32_t* data() const { return labels_.data(); }
+    uint32_t* data() { return labels_.data(); }
+
+private:
+    int width_ = 0;
+    int height_ = 0;
+    std::vector<uint32_t> labels_;
+};
+
+// Generation-stamped membership buffer. A pixel is "visited" when its stamp
+// equals the current generation, so clearing between calls is O(1).
+class VisitedBuffer {
+public:
+    VisitedBuffer() = default;
+    explicit VisitedBuffer(size_t size) : stamps_(size, 0) {}
+
+    void resize(size_t size) {
+        stamps_.assign(size, 0);
+        generation_ = 1;
+    }
+
+    size_t size() const { return stamps_.size(); }
+
+    // Forget all marks
+    void nextGeneration() {
+        if (++generation_ == 0) {
+            // Wrapped around: old stamps could alias, so clear for real
+            std::fill(stamps_.begin(), stamps_.end(), 0);
+            generation_ = 1;
+        }
+    }
+
+    bool test(size_t idx) const { return stamps_[idx] == generation_; }
+    void mark(size_t idx) { stamps_[idx] = generation_; }
+    void unmark(size_t idx) { stamps_[idx] = 0; }
+
+private:
+    std::vector<uint32_t> stamps_;
+    uint32_t generation_ = 1;
+};
+
+} // namespace ic
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "utils/image_utils.hpp"
+#include <vector>
+#include <cstdint>
+
+namespace ic {
+
+// Per-image integral images (summed-area tables) of the channel sums and the
+// sum of squares. Built once per image, they answer windowed mean/variance
+// queries in O(1) for any radius without touching the pixels again.
+class LocalStatistics {
+public:
+    explicit LocalStatistics(const Image& image);
+
+    int getWidth() const { return width_; }
+    int getHeight() const { return height_; }
+
+    // Largest window radius; larger radii are clamped to it. Keeps every
+    // window sum below 2^32 (255 * 2049^2 < 2^30).
+    static constexpr int kMaxRadius = 1024;
+
+    // Variance of the window [x-radius, x+radius] x [y-radius, y+radius]
+    // (clipped to the image) around its truncated integer mean color,
+    // normalized by count * 3 * 255^2. Matches the brute-force loop exactly.
+    double normalizedVariance(int x, int y, int radius) const;
+
+private:
+    int width_;
+    int height_;
+    size_t stride_;
+
+    // Channel sums wrap around in 32 bits; window sums stay below 2^32 (see
+    // kMaxRadius), so differences of wrapped values are still exact.
+    std::vector<uint32_t> sums_;      // 3 per entry (r, g, b)
+    std::vector<uint64_t> squares_;   // r^2 + g^2 + b^2
+
+    size_t entry(int x, int y) const { return static_cast<size_t>(y) * stride_ + x; }
+};
+
+} // namespace ic
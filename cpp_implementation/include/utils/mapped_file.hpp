@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace ic {
+
+// A file mapped into memory. Read mappings are private (copy-on-write), so
+// pixels can be modified in place without touching the file; write
+// mappings create the file at a fixed size, with its blocks allocated up
+// front, and are shared with it.
+// Platforms without mmap fall back to an in-memory buffer that is read
+// up front or written out on close.
+class MappedFile {
+public:
+    // Map an existing file; throws std::runtime_error on failure
+    static MappedFile openRead(const std::string& path);
+
+    // Create (or truncate) path to size bytes and map it for writing;
+    // throws std::runtime_error if the space can't be allocated
+    static MappedFile create(const std::string& path, size_t size);
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    ~MappedFile();
+
+    uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+
+    // Unmap, writing a write mapping back to disk first (msync); returns
+    // false if that fails
+    bool close();
+
+private:
+    MappedFile() = default;
+
+    uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    bool writable_ = false;
+    std::string path_;
+};
+
+} // namespace ic
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+// Per-phase timers and hot-path counters. Each thread accumulates into its
+// own block, so recording never contends; collect() sums the blocks. Build
+// with IC_ENABLE_METRICS=0 (cmake -DIC_ENABLE_METRICS=OFF) and every
+// recording call below compiles to nothing.
+#ifndef IC_ENABLE_METRICS
+#define IC_ENABLE_METRICS 1
+#endif
+
+namespace ic {
+namespace metrics {
+
+constexpr bool kEnabled = IC_ENABLE_METRICS != 0;
+
+// Timed stages of a compression job
+enum class Phase {
+    DECODE,          // reading and decoding the input image
+    LOCAL_STATS,     // summed-area tables for adaptive thresholds
+    REGION_GROWTH,   // findRegion / segmenter labeling
+    AVERAGING,       // post-pass mean colors (growers now sum as they go; kept for reports)
+    STITCHING,       // merging regions across tile edges
+    ENCODE,          // rendering and writing the output
+    PYRAMID,         // downsampling for pyramid mode
+    MERGING,         // folding small regions into their neighbors
+    COUNT
+};
+
+// Events too frequent to time individually
+enum class Counter {
+    QUEUE_PUSHES,
+    QUEUE_POPS,
+    STALE_POPS,            // popped pixels that were already taken
+    SIMILARITY_LOOKUPS,
+    CACHE_HITS,
+    CACHE_MISSES,
+    ADAPTIVE_THRESHOLDS,   // calculateAdaptiveThreshold calls
+    BYTES_ALLOCATED,       // image, label and region buffers
+    COUNT
+};
+
+constexpr size_t kPhaseCount = static_cast<size_t>(Phase::COUNT);
+constexpr size_t kCounterCount = static_cast<size_t>(Counter::COUNT);
+
+// snake_case names used in summaries and JSON
+const char* phaseName(Phase phase);
+const char* counterName(Counter counter);
+
+// Totals at one point in time
+struct Snapshot {
+    std::array<uint64_t, kPhaseCount> phaseNanos{};
+    std::array<uint64_t, kPhaseCount> phaseCalls{};
+    std::array<uint64_t, kCounterCount> counters{};
+
+    double seconds(Phase phase) const { return phaseNanos[static_cast<size_t>(phase)] * 1e-9; }
+    uint64_t calls(Phase phase) const { return phaseCalls[static_cast<size_t>(phase)]; }
+    uint64_t count(Counter counter) const { return counters[static_cast<size_t>(counter)]; }
+    bool empty() const;
+
+    Snapshot& operator+=(const Snapshot& other);
+    Snapshot operator-(const Snapshot& other) const;
+
+    // {"phases": {name: {"seconds": s, "calls": n}, ...}, "counters": {...}}
+    void writeJson(std::ostream& out) const;
+};
+
+// Sum over every thread that recorded anything, running or exited. Always
+// empty when metrics are compiled out.
+Snapshot collect();
+
+#if IC_ENABLE_METRICS
+
+namespace detail {
+
+// One thread's accumulators. Only the owning thread writes, so a relaxed
+// load/store pair is enough and stays race-free against collect().
+struct ThreadBlock {
+    std::array<std::atomic<uint64_t>, kPhaseCount> phaseNanos{};
+    std::array<std::atomic<uint64_t>, kPhaseCount> phaseCalls{};
+    std::array<std::atomic<uint64_t>, kCounterCount> counters{};
+
+    ThreadBlock();
+    ~ThreadBlock();
+    Snapshot snapshot() const;
+};
+
+ThreadBlock& threadBlock();
+
+inline void bump(std::atomic<uint64_t>& slot, uint64_t amount) {
+    slot.store(slot.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+} // namespace detail
+
+inline void count(Counter counter, uint64_t amount = 1) {
+    detail::bump(detail::threadBlock().counters[static_cast<size_t>(counter)], amount);
+}
+
+inline void addTime(Phase phase, std::chrono::steady_clock::duration elapsed) {
+    detail::ThreadBlock& block = detail::threadBlock();
+    size_t index = static_cast<size_t>(phase);
+    detail::bump(block.phaseNanos[index],
+                 static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+    detail::bump(block.phaseCalls[index], 1);
+}
+
+// Adds the lifetime of the scope to a phase
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Phase phase) : phase_(phase), start_(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer() { addTime(phase_, std::chrono::steady_clock::now() - start_); }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    Phase phase_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+#else
+
+inline void count(Counter, uint64_t = 1) {}
+inline void addTime(Phase, std::chrono::steady_clock::duration) {}
+
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Phase) {}
+};
+
+#endif
+
+} // namespace metrics
+} // namespace ic
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <thread>
+
+namespace ic {
+
+// Point-in-time view of a running job
+struct ProgressSample {
+    double progress = 0.0;          // 0..1
+    int64_t processedPixels = 0;
+    int64_t totalPixels = 0;
+    int64_t regions = 0;
+    double elapsed = 0.0;           // seconds
+    double rate = 0.0;              // pixels per second
+    double remaining = 0.0;         // estimated seconds left
+    bool finished = false;          // last sample of the job
+
+    // One line of JSON, e.g. for a job scheduler reading a progress stream
+    void writeJson(std::ostream& out) const;
+};
+
+// Counters that workers bump while compressing: plain relaxed atomics, so
+// recording progress costs one uncontended add and never takes a lock
+class ProgressCounters {
+public:
+    void reset(int64_t totalPixels) {
+        totalPixels_.store(totalPixels, std::memory_order_relaxed);
+        processedPixels_.store(0, std::memory_order_relaxed);
+        regions_.store(0, std::memory_order_relaxed);
+        start_ = std::chrono::steady_clock::now();
+    }
+
+    void add(int64_t pixels, int64_t regions = 1) {
+        processedPixels_.fetch_add(pixels, std::memory_order_relaxed);
+        regions_.fetch_add(regions, std::memory_order_relaxed);
+    }
+
+    ProgressSample sample() const;
+
+private:
+    std::atomic<int64_t> totalPixels_{0};
+    std::atomic<int64_t> processedPixels_{0};
+    std::atomic<int64_t> regions_{0};
+    std::chrono::steady_clock::time_point start_ = std::chrono::steady_clock::now();
+};
+
+using ProgressSink = std::function<void(const ProgressSample& sample)>;
+
+// Samples a set of counters on its own thread every interval and hands the
+// sample to the sink, so rendering and any allocation it does stay off the
+// compressing threads. stop() (or destruction) delivers one final sample
+// marked finished. The sink only ever runs on the reporter thread.
+class ProgressReporter {
+public:
+    ProgressReporter(const ProgressCounters& counters, double intervalSeconds, ProgressSink sink);
+    ~ProgressReporter();
+
+    ProgressReporter(const ProgressReporter&) = delete;
+    ProgressReporter& operator=(const ProgressReporter&) = delete;
+
+    void stop();
+
+private:
+    const ProgressCounters& counters_;
+    std::chrono::duration<double> interval_;
+    ProgressSink sink_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stopping_ = false;
+    std::thread thread_;
+
+    void run();
+};
+
+} // namespace ic
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace ic {
+
+// Static order-0 byte coder (rANS, 12-bit probabilities, byte-wise
+// renormalization). The output starts with the 256-entry frequency table,
+// followed by the coded bytes; decoding needs the original length.
+std::vector<uint8_t> ransEncode(const std::vector<uint8_t>& input);
+
+// Throws std::runtime_error on malformed input
+std::vector<uint8_t> ransDecode(const uint8_t* data, size_t size, size_t outputSize);
+
+} // namespace ic
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "utils/image_utils.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace ic {
+
+// One region inside a RegionBuffer
+struct RegionView {
+    uint32_t offset = 0;
+    uint32_t length = 0;
+};
+
+// Pixel indices (y * width + x) of any number of regions stored back to
+// back. Growers append to it; clear() keeps the capacity, so a buffer that
+// is reused across seeds stops allocating once it has seen the largest
+// region.
+class RegionBuffer {
+public:
+    void clear() { indices_.clear(); }
+    void reserve(size_t count) { indices_.reserve(count); }
+
+    uint32_t size() const { return static_cast<uint32_t>(indices_.size()); }
+    size_t capacity() const { return indices_.capacity(); }
+
+    void push(uint32_t index) { indices_.push_back(index); }
+    uint32_t operator[](size_t i) const { return indices_[i]; }
+
+    // Everything appended since offset
+    RegionView since(uint32_t offset) const { return RegionView{offset, size() - offset}; }
+
+    Span<const uint32_t> indices(const RegionView& view) const {
+        return Span<const uint32_t>(indices_.data() + view.offset, view.length);
+    }
+
+private:
+    std::vector<uint32_t> indices_;
+};
+
+} // namespace ic
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "utils/image_utils.hpp"
+#include "utils/label_map.hpp"
+#include "utils/region_sums.hpp"
+#include "utils/disjoint_set.hpp"
+#include <vector>
+#include <cstdint>
+
+namespace ic {
+
+// One direction of an adjacency between two regions
+struct RegionEdge {
+    uint32_t target;       // neighbor id (resolve with RegionGraph::find after merges)
+    uint32_t boundary;     // number of 4-neighbor pixel pairs the regions share
+    float colorDelta;      // RGB distance between the mean colors when the edge was written
+};
+
+// Region adjacency graph of a label map, plus the channel sums of every
+// region. Built in one pass over the labels; from then on merging regions
+// touches only the graph, so cleanup passes cost time in the number of
+// regions and edges rather than pixels.
+//
+// Edges are stored CSR style: one array of RegionEdge, sorted by source
+// id, with an offset per id. The array never changes; a merge unites the
+// ids in a disjoint set and splices their member lists, so the neighbors of
+// a merged region are the edges of all its members.
+class RegionGraph {
+public:
+    RegionGraph(const LabelMap& labels, const Image& image, size_t regionCount);
+
+    // Ids the graph was built with, and those not yet merged into another
+    size_t regionCount() const { return sums_.size(); }
+    size_t liveRegions() const { return liveRegions_; }
+
+    // Edges as built (each adjacency appears once from each side)
+    size_t edgeCount() const { return edges_.size(); }
+
+    uint32_t find(uint32_t id) { return sets_.find(id); }
+    const RegionSums& sums(uint32_t root) const { return sums_[root]; }
+
+    // Edges of one original id; targets are original ids too
+    Span<const RegionEdge> edges(uint32_t id) const {
+        return Span<const RegionEdge>(edges_.data() + offsets_[id], offsets_[id + 1] - offsets_[id]);
+    }
+
+    // Call visit(neighborRoot, edge) for every edge leaving the members of
+    // root, skipping edges inside it. A neighbor touched by several members
+    // is visited once per edge.
+    template <typename Visitor>
+    void forEachNeighbor(uint32_t root, Visitor&& visit) {
+        for (uint32_t member = root; member != kEnd; member = nextMember_[member]) {
+            for (const RegionEdge& edge : edges(member)) {
+                uint32_t neighbor = sets_.find(edge.target);
+                if (neighbor != root) {
+                    visit(neighbor, edge);
+                }
+            }
+        }
+    }
+
+    // Current RGB distance between the mean colors of two roots
+    float colorDelta(uint32_t rootA, uint32_t rootB) const;
+
+    // Merge two distinct roots; returns the survivor
+    uint32_t merge(uint32_t rootA, uint32_t rootB);
+
+    // Give the live roots dense ids, appending their colors and sizes;
+    // returns the new id of every old id
+    std::vector<uint32_t> compact(std::vector<Color>& colors, std::vector<int>& sizes);
+
+private:
+    static constexpr uint32_t kEnd = 0xFFFFFFFFu;
+
+    std::vector<RegionSums> sums_;
+    DisjointSet sets_;
+    size_t liveRegions_ = 0;
+
+    std::vector<RegionEdge> edges_;
+    std::vector<uint32_t> offsets_;      // regionCount + 1 entries
+
+    // Members of each set as a singly linked list from the root
+    std::vector<uint32_t> nextMember_;
+    std::vector<uint32_t> lastMember_;
+};
+
+// When the priority merge stops; a zero field is not a limit
+struct MergeTarget {
+    size_t regionCount = 0;        // stop once this few regions remain
+    double maxColorDelta = 0.0;    // never merge regions whose means are further apart
+
+    bool enabled() const { return regionCount > 0 || maxColorDelta > 0.0; }
+};
+
+// Fold every region smaller than minSize into the neighbor with the closest
+// mean color, smallest regions first; merges that would exceed
+// maxRegionSize (when > 0) are skipped. Returns the number of merges.
+int mergeSmallRegions(RegionGraph& graph, uint32_t minSize, int maxRegionSize);
+
+// Repeatedly merge the adjacent pair with the smallest color delta until the
+// target is met. The heap holds every edge once; a popped edge whose delta
+// grew since it was queued (one side merged) goes back with the new delta,
+// so each merge costs O(log E) instead of requeueing the survivor's edges.
+// Returns the number of merges.
+int mergeToTarget(RegionGraph& graph, const MergeTarget& target, int maxRegionSize);
+
+} // namespace ic
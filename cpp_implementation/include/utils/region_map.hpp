@@ -0,0 +1,44 @@
+#pragma once
+
+#include "utils/image_utils.hpp"
+#include "utils/label_map.hpp"
+#include <vector>
+#include <string>
+#include <cstdint>
+
+namespace ic {
+
+// Native compressed output (.icr): the palette of region colors plus the
+// label map, run-length coded row by row and optionally entropy coded.
+// Loading one back needs no segmentation, just a fill.
+class RegionMap {
+public:
+    static constexpr const char* kExtension = ".icr";
+
+    RegionMap() = default;
+    RegionMap(LabelMap labels, std::vector<Color> palette);
+
+    // True for paths with the .icr extension
+    static bool isRegionMapPath(const std::string& path);
+
+    // Throw std::runtime_error if the file can't be read or is malformed
+    static RegionMap load(const std::string& path);
+    static RegionMap decode(const std::vector<uint8_t>& bytes);
+
+    std::vector<uint8_t> encode(bool entropyCoded = true) const;
+    bool save(const std::string& path, bool entropyCoded = true) const;
+
+    // Every pixel filled with its region's color
+    Image render() const;
+
+    int getWidth() const { return labels_.getWidth(); }
+    int getHeight() const { return labels_.getHeight(); }
+    const LabelMap& getLabels() const { return labels_; }
+    const std::vector<Color>& getPalette() const { return palette_; }
+
+private:
+    LabelMap labels_;
+    std::vector<Color> palette_;
+};
+
+} // namespace ic
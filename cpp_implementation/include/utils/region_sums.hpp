@@ -0,0 +1,67 @@
+#pragma once
+
+#include "utils/image_utils.hpp"
+#include <algorithm>
+#include <cstdint>
+
+namespace ic {
+
+// Exact channel sums of a region, for merging regions and taking their mean
+struct RegionSums {
+    uint64_t r = 0, g = 0, b = 0;
+    uint32_t count = 0;
+
+    void add(const Color& color) {
+        r += color.r;
+        g += color.g;
+        b += color.b;
+        ++count;
+    }
+
+    void remove(const Color& color) {
+        r -= color.r;
+        g -= color.g;
+        b -= color.b;
+        --count;
+    }
+
+    void merge(const RegionSums& other) {
+        r += other.r;
+        g += other.g;
+        b += other.b;
+        count += other.count;
+    }
+
+    // Truncating mean, like Image::calculateAverageColor
+    Color mean() const {
+        return Color(static_cast<uint8_t>(r / count),
+                     static_cast<uint8_t>(g / count),
+                     static_cast<uint8_t>(b / count));
+    }
+};
+
+// Sums plus bounding box, accumulated by the growers as they accept pixels
+struct RegionStats {
+    RegionSums sums;
+    int minX = 0, minY = 0, maxX = -1, maxY = -1;
+
+    void reset() { *this = RegionStats(); }
+
+    void add(int x, int y, const Color& color) {
+        if (sums.count == 0) {
+            minX = maxX = x;
+            minY = maxY = y;
+        }
+        else {
+            minX = std::min(minX, x);
+            maxX = std::max(maxX, x);
+            minY = std::min(minY, y);
+            maxY = std::max(maxY, y);
+        }
+        sums.add(color);
+    }
+
+    Rect bounds() const { return Rect(minX, minY, maxX - minX + 1, maxY - minY + 1); }
+};
+
+} // namespace ic
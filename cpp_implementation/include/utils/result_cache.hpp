@@ -0,0 +1,56 @@
+#pragma once
+
+#include "utils/region_map.hpp"
+#include <string>
+#include <mutex>
+#include <cstdint>
+
+namespace ic {
+
+// 64-bit hash of a byte range, four multiply-rotate lanes over 8-byte
+// words; a few GB/s, so hashing a frame costs far less than segmenting it.
+// Not cryptographic.
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 0);
+
+// Compression results on disk, one region map (.icr) per key, so an image
+// compressed again with the same settings is a hash plus a read. Keys are
+// the hash of the pixels and the hash of every option that changes the
+// output. Files are used as the LRU list through their modification time:
+// a hit touches its entry, and a store evicts the least recently used
+// entries until the directory fits in maxBytes. Thread-safe within a
+// process; processes sharing a directory at worst miss or re-store.
+class ResultCache {
+public:
+    struct Key {
+        uint64_t content = 0;
+        uint64_t parameters = 0;
+    };
+
+    // Creates the directory if needed; throws std::runtime_error if it can't
+    ResultCache(std::string directory, uint64_t maxBytes = kDefaultMaxBytes);
+
+    static constexpr uint64_t kDefaultMaxBytes = 1024ull * 1024 * 1024;
+
+    // Hash of an image's dimensions and pixels
+    static uint64_t hashImage(const Image& image);
+
+    // False on a miss; a malformed entry is removed and counts as one
+    bool load(const Key& key, RegionMap& result);
+
+    // Write (or replace) an entry, then evict down to the size limit.
+    // Failures only cost the entry; compression doesn't depend on the cache.
+    void store(const Key& key, const RegionMap& result, bool entropyCoded = true);
+
+    const std::string& getDirectory() const { return directory_; }
+    uint64_t getMaxBytes() const { return maxBytes_; }
+
+private:
+    std::string directory_;
+    uint64_t maxBytes_;
+    std::mutex mutex_;
+
+    std::string pathFor(const Key& key) const;
+    void evict();
+};
+
+} // namespace ic
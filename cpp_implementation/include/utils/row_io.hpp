@@ -0,0 +1,66 @@
+#pragma once
+
+#include "utils/image_utils.hpp"
+#include <fstream>
+#include <string>
+
+namespace ic {
+
+// Sequential reader for row-oriented sources: binary PPM (P6, maxval 255)
+// or headerless raw interleaved RGB of a known size. Only the rows being
+// read need to be in memory.
+class RowReader {
+public:
+    // Open a PPM file; throws std::runtime_error if it can't be read
+    explicit RowReader(const std::string& path);
+
+    // Open a raw RGB file of width * height pixels
+    RowReader(const std::string& path, int width, int height);
+
+    int getWidth() const { return width_; }
+    int getHeight() const { return height_; }
+    int getRowsRead() const { return rowsRead_; }
+
+    // Read up to count rows into buffer (count * width pixels); returns the
+    // number of rows read, 0 at the end. Throws on a short file.
+    int readRows(Color* buffer, int count);
+
+private:
+    std::ifstream file_;
+    std::string path_;
+    int width_ = 0;
+    int height_ = 0;
+    int rowsRead_ = 0;
+};
+
+// Sequential PPM (or, for a .raw/.rgb path, headerless RGB) writer
+class RowWriter {
+public:
+    // Throws std::runtime_error if the file can't be created
+    RowWriter(const std::string& path, int width, int height);
+
+    // Append count rows of width pixels; returns false on I/O failure
+    bool writeRows(const Color* rows, int count);
+
+    // Flush and close; returns false if any write failed
+    bool close();
+
+private:
+    std::ofstream file_;
+    int width_;
+};
+
+// True for paths with a .raw or .rgb extension
+bool isRawPath(const std::string& path);
+
+// True for paths with a .ppm extension
+bool isPpmPath(const std::string& path);
+
+// Parse a P6/255 header, leaving in at the first pixel byte; throws
+// std::runtime_error if the header is malformed or not 8-bit
+void readPpmHeader(std::istream& in, const std::string& path, int& width, int& height);
+
+// Header written before width * height pixels of binary PPM
+std::string ppmHeader(int width, int height);
+
+} // namespace ic
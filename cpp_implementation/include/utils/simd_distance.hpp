@@ -0,0 +1,53 @@
+#pragma once
+
+#include "utils/image_utils.hpp"
+#include <cstdint>
+
+namespace ic {
+
+// Instruction sets the batch distance kernels are built for. Intrinsic code
+// is compiled per function (target attributes), so one binary carries every
+// x86 variant and picks one at runtime; NEON is baseline on AArch64.
+enum class SimdLevel {
+    SCALAR,
+    SSE4,
+    AVX2,
+    NEON
+};
+
+const char* simdLevelName(SimdLevel level);
+
+// Best level the running CPU supports (detected once)
+SimdLevel detectSimdLevel();
+
+// Up to 8 candidate colors in planar layout, so a kernel loads each channel
+// of every lane with one instruction. Unused lanes are left zero.
+struct ColorBatch {
+    static constexpr int kLanes = 8;
+
+    alignas(16) uint8_t r[kLanes] = {};
+    alignas(16) uint8_t g[kLanes] = {};
+    alignas(16) uint8_t b[kLanes] = {};
+    int count = 0;
+
+    void add(const Color& color) {
+        r[count] = color.r;
+        g[count] = color.g;
+        b[count] = color.b;
+        ++count;
+    }
+};
+
+// For every lane i: best[i] = min(|a - batch[i]|^2, |b - batch[i]|^2), the
+// exact integer squared RGB distance to the closer of the two references.
+// All 8 lanes are written; lanes past batch.count are meaningless.
+using BestSquaredDistanceKernel = void (*)(const Color& a, const Color& b, const ColorBatch& batch,
+                                           int32_t* best);
+
+// Kernel for a level, falling back to scalar when the CPU lacks it
+BestSquaredDistanceKernel bestSquaredDistanceKernel(SimdLevel level);
+
+// Kernel for detectSimdLevel()
+BestSquaredDistanceKernel bestSquaredDistanceKernel();
+
+} // namespace ic
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "utils/image_utils.hpp"
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace ic {
+
+// Fixed-size, direct-mapped cache of colorSimilarity results keyed on the
+// (unordered) pair of RGB triples. Each pair packs into a 48-bit integer, so
+// a lookup is one multiply, one shift and one table probe with no allocation.
+class SimilarityCache {
+public:
+    // Default number of slots (16 bytes each, so 1 MB)
+    static constexpr size_t kDefaultEntries = size_t(1) << 16;
+
+    // Largest number of slots (256 MB); every grower owns a cache
+    static constexpr size_t kMaxEntries = size_t(1) << 24;
+
+    // The entry count is rounded up to a power of two and clamped to
+    // kMaxEntries; 0 disables caching
+    explicit SimilarityCache(size_t entries = kDefaultEntries);
+
+    // Get similarity from the cache or calculate and store it
+    double get(const Color& c1, const Color& c2) {
+        if (entries_.empty()) {
+            return colorSimilarity(c1, c2);
+        }
+
+        uint64_t key = makeKey(c1, c2);
+        Entry& entry = entries_[slotFor(key)];
+        if (entry.key == key) {
+            ++hits_;
+            return entry.value;
+        }
+
+        ++misses_;
+        entry.key = key;
+        entry.value = colorSimilarity(c1, c2);
+        return entry.value;
+    }
+
+    // Drop all cached values (counters are kept)
+    void clear();
+
+    size_t capacity() const { return entries_.size(); }
+    uint64_t hits() const { return hits_; }
+    uint64_t misses() const { return misses_; }
+
+    // Pack two colors into a 48-bit key; order doesn't matter for similarity
+    static uint64_t makeKey(const Color& c1, const Color& c2) {
+        uint64_t a = c1.hash();
+        uint64_t b = c2.hash();
+        return a < b ? (a << 24) | b : (b << 24) | a;
+    }
+
+private:
+    struct Entry {
+        uint64_t key;
+        double value;
+    };
+
+    // Keys never use the top 16 bits, so this can never match a real pair
+    static constexpr uint64_t kEmptyKey = ~uint64_t(0);
+
+    std::vector<Entry> entries_;
+    int shift_ = 64;
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+
+    // Fibonacci hashing spreads neighbouring colors across the table
+    size_t slotFor(uint64_t key) const {
+        return static_cast<size_t>((key * 0x9E3779B97F4A7C15ULL) >> shift_);
+    }
+};
+
+} // namespace ic
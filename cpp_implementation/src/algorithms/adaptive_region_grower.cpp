@@ -1,201 +1,391 @@
 #include "algorithms/region_grower.hpp"
-#include <queue>
+#include "utils/metrics.hpp"
 #include <algorithm>
-#include <unordered_set>
-#include <unordered_map>
 #include <functional>
-#include <string>
 
 namespace ic {
 
-AdaptiveRegionGrower::AdaptiveRegionGrower(const Image& image, double similarityThreshold, 
-                                         int maxRegionSize, bool adaptiveMode)
-    : RegionGrower(image, similarityThreshold, maxRegionSize), adaptiveMode_(adaptiveMode) {   // Initialize with a reasonable size to avoid too many rehashes
-    // Initialize with a reasonable size to avoid too many rehashes    similarityCache_.reserve(1000);
-    similarityCache_.reserve(1000);
-}
-n local image characteristics
-// Calculate adaptive threshold based on local image characteristicsreshold(int x, int y, int radius) const {
-double AdaptiveRegionGrower::calculateAdaptiveThreshold(int x, int y, int radius) const {
-    int xMin = std::max(0, x - radius);
-    int xMax = std::min(width_ - 1, x + radius);int yMin = std::max(0, y - radius);
-    int yMin = std::max(0, y - radius); radius);
-    int yMax = std::min(height_ - 1, y + radius);
-    
-    // Sample pixels in the local region
-    std::vector<Color> localColors;
-    for (int ly = yMin; ly <= yMax; ++ly) {or (int lx = xMin; lx <= xMax; ++lx) {
-        for (int lx = xMin; lx <= xMax; ++lx) {       localColors.push_back(image_.getPixel(lx, ly));
-            localColors.push_back(image_.getPixel(lx, ly));    }
-        }
+AdaptiveRegionGrower::AdaptiveRegionGrower(const Image& image, double similarityThreshold,
+                                         int maxRegionSize, bool adaptiveMode,
+                                         size_t cacheEntries,
+                                         std::shared_ptr<const LocalStatistics> localStats)
+    : RegionGrower(image, similarityThreshold, maxRegionSize), adaptiveMode_(adaptiveMode),
+      similarityCache_(cacheEntries), localStats_(std::move(localStats)) {
+    if (adaptiveMode_ && !localStats_) {
+        localStats_ = std::make_shared<LocalStatistics>(image);
     }
-    
-    // Calculate average colorotalG = 0, totalB = 0;
-    uint32_t totalR = 0, totalG = 0, totalB = 0; : localColors) {
-    for (const auto& color : localColors) {
-        totalR += color.r;   totalG += color.g;
-        totalG += color.g;
-        totalB += color.b;
-    }int count = static_cast<int>(localColors.size());
-    int count = static_cast<int>(localColors.size()); / count, totalG / count, totalB / count);
-    Color avgColor(totalR / count, totalG / count, totalB / count);
-    
-    // Calculate variance
-    double variance = 0.0;
-    for (const auto& color : localColors) {
-        double dr = static_cast<double>(color.r) - avgColor.r;r.g) - avgColor.g;
-        double dg = static_cast<double>(color.g) - avgColor.g;   double db = static_cast<double>(color.b) - avgColor.b;
-        double db = static_cast<double>(color.b) - avgColor.b;
-        variance += (dr*dr + dg*dg + db*db);}
-    }// Normalize
-    variance /= (count * 3.0 * 255.0 * 255.0); // Normalize
-    
-    // Adjust threshold based on local variancehreshold
+}
+
+// Calculate adaptive threshold based on local image characteristics
+double AdaptiveRegionGrower::calculateAdaptiveThreshold(int x, int y) const {
+    // Local variance from the summed-area tables, O(1) for any radius
+    double variance = localStats_->normalizedVariance(x, y, adaptiveRadius_);
+
+    // Adjust threshold based on local variance
     // Higher variance (more texture/detail) -> stricter threshold
-    // Lower variance (flat areas) -> more relaxed thresholddouble varianceFactor = std::min(1.0, variance * 2.0);
-    double varianceFactor = std::min(1.0, variance * 2.0);= similarityThreshold_ + (1.0 - similarityThreshold_) * (1.0 - varianceFactor) * 0.3;
-    double adjustedThreshold = similarityThreshold_ + (1.0 - similarityThreshold_) * (1.0 - varianceFactor) * 0.3;   
-        return adjustedThreshold;
+    // Lower variance (flat areas) -> more relaxed threshold
+    double varianceFactor = std::min(1.0, variance * 2.0);
+    double adjustedThreshold = similarityThreshold_ + (1.0 - similarityThreshold_) * (1.0 - varianceFactor) * 0.3;
+
     return adjustedThreshold;
 }
 
-// Get cached similarity valueCachedSimilarity(const Color& c1, const Color& c2) {
-double AdaptiveRegionGrower::getCachedSimilarity(const Color& c1, const Color& c2) {
-    // Create a string key for the cache (make sure color order doesn't matter)lor> key;
-    Color first = c1, second = c2; < c2.r || (c1.r == c2.r && (c1.g < c2.g || (c1.g == c2.g && c1.b < c2.b)))) {
-    if (c2.r < c1.r || (c2.r == c1.r && (c2.g < c1.g || (c2.g == c1.g && c2.b < c1.b)))) {
-        first = c2; else {
-        second = c1;    key = {c2, c1};
+namespace {
+
+// Similarity measured in double precision (optionally through the cache)
+class DirectMetric {
+public:
+    using Value = double;
+
+    explicit DirectMetric(SimilarityCache& cache) : cache_(cache) {}
+
+    Value measure(const Color& c1, const Color& c2) { return cache_.get(c1, c2); }
+    Value bound(double threshold) const { return threshold; }
+    // Bit-identical to colorSimilarity() on the same pair
+    static Value fromSquaredDistance(int32_t squared) { return similarityFromSquaredDistance(squared); }
+
+    static bool passes(Value value, Value bound) { return value >= bound; }
+    // Higher similarity = higher priority (lower value)
+    static double priority(Value value) { return 1.0 - value; }
+    static double similarity(Value value) { return value; }
+
+private:
+    SimilarityCache& cache_;
+};
+
+// Similarity measured as integer squared distance against a threshold that
+// was converted to squared space. The mapping is strictly monotonic, so every
+// comparison (and therefore the queue order) matches DirectMetric exactly.
+class TableMetric {
+public:
+    using Value = int32_t;
+
+    TableMetric() : tables_(ColorTables::instance()) {}
+
+    Value measure(const Color& c1, const Color& c2) const { return tables_.squaredDistance(c1, c2); }
+    Value bound(double threshold) const { return ColorTables::similarityToSquaredThreshold(threshold); }
+    static Value fromSquaredDistance(int32_t squared) { return squared; }
+
+    static bool passes(Value value, Value bound) { return value <= bound; }
+    static double priority(Value value) { return static_cast<double>(value); }
+    static double similarity(Value value) { return similarityFromSquaredDistance(value); }
+
+private:
+    const ColorTables& tables_;
+};
+
+// Frontier on a binary heap with exact priorities, kept in the grower's
+// scratch storage. A pixel may be queued several times; the grower skips the
+// stale copies when they're popped. Same heap operations, and so the same
+// pop order, as std::priority_queue with std::greater.
+template <typename Metric>
+class HeapFrontier {
+public:
+    using Value = typename Metric::Value;
+
+    explicit HeapFrontier(std::vector<FrontierEntry>& heap) : heap_(heap) {
+        heap_.clear();
     }
-    
-    // Create a string key
-    std::string key = std::to_string(first.r) + "-" + che_.find(key);
-                    std::to_string(first.g) + "-" + f (it != similarityCache_.end()) {
-                    std::to_string(first.b) + "_" +    return it->second;
-                    std::to_string(second.r) + "-" + 
-                    std::to_string(second.g) + "-" + 
-                    std::to_string(second.b);
-    = colorSimilarity(c1, c2);
-    // Check cache   similarityCache_[key] = similarity;
-    auto it = similarityCache_.find(key);    return similarity;
-    if (it != similarityCache_.end()) {
-        return it->second;
-    }onGrower::findRegion(int seedX, int seedY, 
-    nst std::vector<std::vector<bool>>& processed) {
-    // Calculate and cache// Get the seed pixel color
-    double similarity = colorSimilarity(c1, c2);age_.getPixel(seedX, seedY);
-    similarityCache_[key] = similarity;
-    return similarity;
-}std::unordered_set<Point, PointHash> region;
-> regionList;
-std::vector<Point> AdaptiveRegionGrower::findRegion(int seedX, int seedY, 
-                                                  const std::vector<std::vector<bool>>& processed) {
-    // Get the seed pixel color
-    Color seedColor = image_.getPixel(seedX, seedY);region.insert(seedPoint);
-    
+
+    void push(const Point& point, size_t /*localIndex*/, Value value) {
+        heap_.push_back({Metric::priority(value), point});
+        std::push_heap(heap_.begin(), heap_.end(), std::greater<FrontierEntry>());
+    }
+
+    bool empty() const { return heap_.empty(); }
+
+    Point pop() {
+        std::pop_heap(heap_.begin(), heap_.end(), std::greater<FrontierEntry>());
+        Point point = heap_.back().point;
+        heap_.pop_back();
+        return point;
+    }
+
+private:
+    std::vector<FrontierEntry>& heap_;
+};
+
+// Frontier on a bucket queue with similarity quantized to 1/1024 steps.
+// Each pixel is queued at most once, at the best priority seen so far.
+template <typename Metric>
+class BucketFrontier {
+public:
+    using Value = typename Metric::Value;
+
+    BucketFrontier(BucketQueue& queue, const Rect& bounds) : queue_(queue), bounds_(bounds) {
+        if (queue_.capacity() != bounds_.area()) {
+            queue_.resize(bounds_.area());
+        }
+        else {
+            queue_.clear();
+        }
+    }
+
+    void push(const Point& /*point*/, size_t localIndex, Value value) {
+        double distance = 1.0 - Metric::similarity(value);
+        uint32_t bucket = static_cast<uint32_t>(std::max(0.0, distance) * (queue_.bucketCount() - 1));
+        queue_.push(static_cast<uint32_t>(localIndex), bucket);
+    }
+
+    bool empty() const { return queue_.empty(); }
+
+    Point pop() {
+        uint32_t index = queue_.pop();
+        return Point(bounds_.x + static_cast<int>(index % bounds_.width),
+                     bounds_.y + static_cast<int>(index / bounds_.width));
+    }
+
+private:
+    BucketQueue& queue_;
+    Rect bounds_;
+};
+
+// Bits of AdaptiveRegionGrower::kernelKey()
+constexpr uint32_t kKeyFourConnected = 1;
+constexpr uint32_t kKeyTableMetric = 2;
+constexpr uint32_t kKeyBucketFrontier = 4;
+constexpr uint32_t kKeyAdaptive = 8;
+constexpr uint32_t kKeyBounded = 16;
+constexpr uint32_t kKeyRunningMean = 32;
+constexpr uint32_t kKernelCount = 64;
+
+} // namespace
+
+RegionView AdaptiveRegionGrower::appendRegion(int seedX, int seedY, const LabelMap& labels, RegionBuffer& out) {
+    uint64_t hits = similarityCache_.hits();
+    uint64_t misses = similarityCache_.misses();
+    size_t outCapacity = out.capacity();
+    size_t heapCapacity = scratch_.heap.capacity();
+
+    uint32_t key = kernelKey();
+    if (!kernel_ || key != kernelKey_) {
+        kernel_ = kernelFor(key);
+        kernelKey_ = key;
+    }
+    RegionView region = (this->*kernel_)(seedX, seedY, labels, out);
+
+    metrics::count(metrics::Counter::CACHE_HITS, similarityCache_.hits() - hits);
+    metrics::count(metrics::Counter::CACHE_MISSES, similarityCache_.misses() - misses);
+    // The buffers are reused, so only their growth is new memory
+    metrics::count(metrics::Counter::BYTES_ALLOCATED,
+                   (out.capacity() - outCapacity) * sizeof(uint32_t) +
+                   (scratch_.heap.capacity() - heapCapacity) * sizeof(FrontierEntry));
+    return region;
+}
+
+uint32_t AdaptiveRegionGrower::kernelKey() const {
+    // No cap, or one at least as large as the bounds, never stops growth
+    bool bounded = maxRegionSize_ > 0 && static_cast<size_t>(maxRegionSize_) < bounds_.area();
+    return (connectivity_ == Connectivity::FOUR ? kKeyFourConnected : 0) |
+           (distanceMode_ == DistanceMode::TABLE ? kKeyTableMetric : 0) |
+           (frontierMode_ == FrontierMode::BUCKET ? kKeyBucketFrontier : 0) |
+           (adaptiveMode_ ? kKeyAdaptive : 0) |
+           (bounded ? kKeyBounded : 0) |
+           (runningMean_ ? kKeyRunningMean : 0);
+}
+
+template <uint32_t... Keys>
+std::array<AdaptiveRegionGrower::GrowKernel, sizeof...(Keys)>
+AdaptiveRegionGrower::kernelTable(std::integer_sequence<uint32_t, Keys...>) {
+    return {{&AdaptiveRegionGrower::growKernel<Keys>...}};
+}
+
+AdaptiveRegionGrower::GrowKernel AdaptiveRegionGrower::kernelFor(uint32_t key) {
+    static const std::array<GrowKernel, kKernelCount> kernels =
+        kernelTable(std::make_integer_sequence<uint32_t, kKernelCount>());
+    return kernels[key];
+}
+
+template <uint32_t Key>
+RegionView AdaptiveRegionGrower::growKernel(int seedX, int seedY, const LabelMap& labels, RegionBuffer& out) {
+    constexpr Connectivity C = (Key & kKeyFourConnected) ? Connectivity::FOUR : Connectivity::EIGHT;
+    constexpr bool adaptive = (Key & kKeyAdaptive) != 0;
+    constexpr bool bounded = (Key & kKeyBounded) != 0;
+    constexpr bool runningMean = (Key & kKeyRunningMean) != 0;
+    if constexpr ((Key & kKeyTableMetric) != 0) {
+        if constexpr ((Key & kKeyBucketFrontier) != 0) {
+            return growRegion<C, adaptive, bounded, runningMean>(
+                seedX, seedY, labels, out, TableMetric(), BucketFrontier<TableMetric>(scratch_.bucketQueue, bounds_));
+        }
+        else {
+            return growRegion<C, adaptive, bounded, runningMean>(
+                seedX, seedY, labels, out, TableMetric(), HeapFrontier<TableMetric>(scratch_.heap));
+        }
+    }
+    else {
+        if constexpr ((Key & kKeyBucketFrontier) != 0) {
+            return growRegion<C, adaptive, bounded, runningMean>(
+                seedX, seedY, labels, out, DirectMetric(similarityCache_),
+                BucketFrontier<DirectMetric>(scratch_.bucketQueue, bounds_));
+        }
+        else {
+            return growRegion<C, adaptive, bounded, runningMean>(
+                seedX, seedY, labels, out, DirectMetric(similarityCache_), HeapFrontier<DirectMetric>(scratch_.heap));
+        }
+    }
+}
+
+template <Connectivity C, bool Adaptive, bool Bounded, bool RunningMean, typename Metric, typename Frontier>
+RegionView AdaptiveRegionGrower::growRegion(int seedX, int seedY, const LabelMap& labels, RegionBuffer& out,
+                                            Metric metric, Frontier frontier) {
+    using Value = typename Metric::Value;
+
+    // Get the seed pixel color; in running-mean mode this becomes the mean
+    // of the pixels accepted so far
+    Color seedColor = image_.at(seedX, seedY);
+
     // Initialize region
-    std::unordered_set<Point, PointHash> region; region growing
-    std::vector<Point> regionList;arities
-    tem {
-    // Add seed point     // Lower value = higher priority
-    Point seedPoint(seedX, seedY);Point point;
-    region.insert(seedPoint);
-    regionList.push_back(seedPoint);
-    ool operator>(const PriorityItem& other) const {
-    // Priority queue for region growing      return priority > other.priority;
-    // We'll use a custom comparator to prioritize higher similarities    }
-    struct PriorityItem {
-        double priority;       // Lower value = higher priority
-        Point point;rityItem>, std::greater<PriorityItem>> priorityQueue;
-        double similarity;
-        the priority queue
-        bool operator>(const PriorityItem& other) const {dX, seedY, true)) {
-            return priority > other.priority;ready processed
-        }f (processed[neighbor.y][neighbor.x]) {
-    };    continue;
-    
-    std::priority_queue<PriorityItem, std::vector<PriorityItem>, std::greater<PriorityItem>> priorityQueue;
-    Color neighborColor = image_.getPixel(neighbor.x, neighbor.y);
-    // Add neighbors of the seed to the priority queueeighborColor);
-    for (const auto& neighbor : getNeighbors(seedX, seedY, true)) {
-        // Skip if already processed   // Higher similarity = higher priority (lower value)
-        if (processed[neighbor.y][neighbor.x]) {    priorityQueue.push({1.0 - similarity, neighbor, similarity});
-            continue;
+    VisitedBuffer& inRegion = scratch_.inRegion;
+    if (inRegion.size() != bounds_.area()) {
+        inRegion.resize(bounds_.area());
+    }
+    inRegion.nextGeneration();
+    uint32_t offset = out.size();
+    size_t regionSize = 0;
+
+    // Hot-path counts, recorded once per region
+    uint64_t pushes = 0;
+    uint64_t pops = 0;
+    uint64_t stalePops = 0;
+    uint64_t lookups = 0;
+    uint64_t thresholds = 0;
+
+    // Add seed point
+    inRegion.mark(localIndex(seedX, seedY));
+    out.push(imageIndex(seedX, seedY));
+    ++regionSize;
+    lastStats_.reset();
+    lastStats_.add(seedX, seedY, seedColor);
+
+    // Add neighbors of the seed to the frontier
+    forEachNeighbor<C>(seedX, seedY, [&](int nx, int ny) {
+        // Skip if already processed
+        if (labels.isAssigned(nx, ny)) {
+            return;
         }
-        
-        Color neighborColor = image_.getPixel(neighbor.x, neighbor.y);
-        double similarity = getCachedSimilarity(seedColor, neighborColor);                             ? calculateAdaptiveThreshold(seedX, seedY) 
-          : similarityThreshold_;
-        // Higher similarity = higher priority (lower value)
-        priorityQueue.push({1.0 - similarity, neighbor, similarity});
-    }.size() < static_cast<size_t>(maxRegionSize_)) {
-    ity pixel
-    // Calculate base adaptive threshold at seed pointauto current = priorityQueue.top();
-    double baseAdaptiveThreshold = adaptiveMode_ 
-                                 ? calculateAdaptiveThreshold(seedX, seedY) 
-                                 : similarityThreshold_;ready in region or processed
-    f (region.count(current.point) > 0 || processed[current.point.y][current.point.x]) {
-    // Main region growing loop    continue;
-    while (!priorityQueue.empty() && region.size() < static_cast<size_t>(maxRegionSize_)) {
+
+        const Color& neighborColor = image_.at(nx, ny);
+        Value similarity = metric.measure(seedColor, neighborColor);
+        ++lookups;
+
+        frontier.push(Point(nx, ny), localIndex(nx, ny), similarity);
+        ++pushes;
+    });
+
+    // Calculate base adaptive threshold at seed point
+    double baseAdaptiveThreshold = similarityThreshold_;
+    if constexpr (Adaptive) {
+        baseAdaptiveThreshold = calculateAdaptiveThreshold(seedX, seedY);
+        ++thresholds;
+    }
+
+    // Without adaptive mode the bounds never change, so convert them once
+    Value fixedBound = metric.bound(similarityThreshold_);
+    Value fixedQueueBound = metric.bound(similarityThreshold_ * 0.8);
+
+    // Main region growing loop
+    while (!frontier.empty() && (!Bounded || regionSize < static_cast<size_t>(maxRegionSize_))) {
         // Get highest priority pixel
-        auto current = priorityQueue.top();// Get current pixel color
-        priorityQueue.pop();current.point.x, current.point.y);
-        
-        // Skip if already in region or processed// Calculate similarity to seed color
-        if (region.count(current.point) > 0 || processed[current.point.y][current.point.x]) {seedColor, currentColor);
+        Point current = frontier.pop();
+        ++pops;
+
+        // Skip if already in region or processed
+        size_t currentIndex = localIndex(current.x, current.y);
+        if (inRegion.test(currentIndex) || labels.isAssigned(current.x, current.y)) {
+            ++stalePops;
             continue;
-        }e threshold for this pixel
-        
+        }
+
         // Get current pixel color
-        Color currentColor = image_.getPixel(current.point.x, current.point.y);al characteristics
-        current.point.y);
-        // Calculate similarity to seed colorlend with base threshold, favoring stricter values
-        double similarityToSeed = getCachedSimilarity(seedColor, currentColor);Threshold, localThreshold);
-         else {
-        // Calculate adaptive threshold for this pixel    adaptiveThreshold = similarityThreshold_;
-        double adaptiveThreshold;
-        if (adaptiveMode_) {
-            // Scale threshold based on distance from seed and local characteristics good enough
-            double localThreshold = calculateAdaptiveThreshold(current.point.x, current.point.y);d) {
-            // Blend with base threshold, favoring stricter valuesregion.insert(current.point);
-            adaptiveThreshold = std::min(baseAdaptiveThreshold, localThreshold););
-        } else {
-            adaptiveThreshold = similarityThreshold_;
-        } true)) {
-        ready in region or processed
-        // Add to region if similarity is good enoughf (region.count(neighbor) > 0 || processed[neighbor.y][neighbor.x]) {
-        if (similarityToSeed >= adaptiveThreshold) {    continue;
-            region.insert(current.point);
-            regionList.push_back(current.point);
-            neighbor.y);
-            // Add neighbors to priority queue
-            for (const auto& neighbor : getNeighbors(current.point.x, current.point.y, true)) {
-                // Skip if already in region or processeddouble similarityToSeed = getCachedSimilarity(seedColor, neighborColor);
-                if (region.count(neighbor) > 0 || processed[neighbor.y][neighbor.x]) {ilarity(currentColor, neighborColor);
-                    continue;
-                }// Use the better of the two similarities
-                milarityToCurrent);
-                Color neighborColor = image_.getPixel(neighbor.x, neighbor.y);
-                
-                // Check similarity to both seed and current pixel
-                double similarityToSeed = getCachedSimilarity(seedColor, neighborColor);   // Priority is inverse of similarity (lower value = higher priority)
-                double similarityToCurrent = getCachedSimilarity(currentColor, neighborColor);       priorityQueue.push({1.0 - bestSimilarity, neighbor, bestSimilarity});
-                       }
-                // Use the better of the two similarities       }
-                double bestSimilarity = std::max(similarityToSeed, similarityToCurrent);    }
-                
-                // Only add to queue if it passes a minimum threshold   
-                if (bestSimilarity >= adaptiveThreshold * 0.8) {    return regionList;
-                    // Priority is inverse of similarity (lower value = higher priority)
-                    priorityQueue.push({1.0 - bestSimilarity, neighbor, bestSimilarity});
+        Color currentColor = image_.at(current.x, current.y);
 
+        // Calculate similarity to seed color
+        Value similarityToSeed = metric.measure(seedColor, currentColor);
+        ++lookups;
 
+        // Calculate adaptive threshold for this pixel
+        Value acceptBound = fixedBound;
+        Value queueBound = fixedQueueBound;
+        if constexpr (Adaptive) {
+            // Scale threshold based on distance from seed and local characteristics
+            double localThreshold = calculateAdaptiveThreshold(current.x, current.y);
+            ++thresholds;
+            // Blend with base threshold, favoring stricter values
+            double adaptiveThreshold = std::min(baseAdaptiveThreshold, localThreshold);
+            acceptBound = metric.bound(adaptiveThreshold);
+            queueBound = metric.bound(adaptiveThreshold * 0.8);
+        }
 
+        // Add to region if similarity is good enough
+        if (Metric::passes(similarityToSeed, acceptBound)) {
+            inRegion.mark(currentIndex);
+            out.push(imageIndex(current.x, current.y));
+            ++regionSize;
+            lastStats_.add(current.x, current.y, currentColor);
+            if constexpr (RunningMean) {
+                seedColor = lastStats_.sums.mean();
+            }
 
+            // Gather the open neighbors, then measure each against both the
+            // seed and the current pixel in one batch. Similarity falls as
+            // squared distance grows, so the closer reference gives the better
+            // of the two similarities exactly.
+            ColorBatch batch;
+            Point candidates[ColorBatch::kLanes];
+            forEachNeighbor<C>(current.x, current.y, [&](int nx, int ny) {
+                // Skip if already in region or processed
+                if (inRegion.test(localIndex(nx, ny)) || labels.isAssigned(nx, ny)) {
+                    return;
+                }
+                candidates[batch.count] = Point(nx, ny);
+                batch.add(image_.at(nx, ny));
+            });
 
+            int32_t bestSquared[ColorBatch::kLanes];
+            bestDistance_(seedColor, currentColor, batch, bestSquared);
+            lookups += 2 * static_cast<uint64_t>(batch.count);
 
+            for (int i = 0; i < batch.count; ++i) {
+                Value bestSimilarity = Metric::fromSquaredDistance(bestSquared[i]);
 
+                // Only add to queue if it passes a minimum threshold
+                if (Metric::passes(bestSimilarity, queueBound)) {
+                    // Priority is inverse of similarity (lower value = higher priority)
+                    const Point& neighbor = candidates[i];
+                    frontier.push(neighbor, localIndex(neighbor.x, neighbor.y), bestSimilarity);
+                    ++pushes;
+                }
+            }
+        }
+    }
 
+    // Stopped by the cap: truncated only if something still queued would
+    // have passed the same accept test (skipping stale copies)
+    lastTruncated_ = false;
+    if constexpr (Bounded) {
+        while (!frontier.empty()) {
+            Point pending = frontier.pop();
+            if (inRegion.test(localIndex(pending.x, pending.y)) || labels.isAssigned(pending.x, pending.y)) {
+                continue;
+            }
+            Value acceptBound = fixedBound;
+            if constexpr (Adaptive) {
+                acceptBound = metric.bound(std::min(baseAdaptiveThreshold,
+                                                    calculateAdaptiveThreshold(pending.x, pending.y)));
+            }
+            if (Metric::passes(metric.measure(seedColor, image_.at(pending.x, pending.y)), acceptBound)) {
+                lastTruncated_ = true;
+                break;
+            }
+        }
+    }
 
+    metrics::count(metrics::Counter::QUEUE_PUSHES, pushes);
+    metrics::count(metrics::Counter::QUEUE_POPS, pops);
+    metrics::count(metrics::Counter::STALE_POPS, stalePops);
+    metrics::count(metrics::Counter::SIMILARITY_LOOKUPS, lookups);
+    metrics::count(metrics::Counter::ADAPTIVE_THRESHOLDS, thresholds);
+    return out.since(offset);
+}
 
-} // namespace ic}    return regionList;        }        }            }                }} // namespace ic
+} // namespace ic
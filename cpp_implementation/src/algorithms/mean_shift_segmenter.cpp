@@ -0,0 +1,406 @@
+#include "algorithms/region_grower.hpp"
+#include "utils/thread_pool.hpp"
+#include "utils/disjoint_set.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cmath>
+#include <future>
+
+namespace ic {
+
+namespace {
+
+// A point in the joint domain: position in pixels, color in 0-255 units
+struct Feature {
+    float x = 0, y = 0, r = 0, g = 0, b = 0;
+};
+
+// Pixels of one spatial cell whose colors quantize to the same key
+struct Bin {
+    Feature mean;
+    uint32_t count = 0;
+};
+
+constexpr uint32_t kNoBin = 0xFFFFFFFFu;
+constexpr int kMaxIterations = 20;
+constexpr float kConvergence = 1e-3f;     // squared normalized shift
+constexpr float kMergeDistance = 0.5f;    // normalized distance between modes
+
+// Squared joint distance in bandwidth units
+float normalizedDistance(const Feature& a, const Feature& b, float invSpatial2, float invColor2) {
+    float dx = a.x - b.x, dy = a.y - b.y;
+    float dr = a.r - b.r, dg = a.g - b.g, db = a.b - b.b;
+    return (dx * dx + dy * dy) * invSpatial2 + (dr * dr + dg * dg + db * db) * invColor2;
+}
+
+// Pixels bucketed by spatial cell and quantized color. The bins of one cell
+// are stored contiguously (cellStart_ is a CSR offset table), sorted by key,
+// so a kernel evaluation only looks at the cells its window overlaps.
+class SpatialColorGrid {
+public:
+    SpatialColorGrid(const Image& image, int cellSize, float colorStep, ThreadPool& pool)
+        : cellSize_(cellSize), colorStep_(colorStep),
+          cellsX_((image.getWidth() + cellSize - 1) / cellSize),
+          cellsY_((image.getHeight() + cellSize - 1) / cellSize),
+          pixelBin_(image.getPixelCount()) {
+        build(image, pool);
+    }
+
+    int cellSize() const { return cellSize_; }
+    int cellsX() const { return cellsX_; }
+    int cellsY() const { return cellsY_; }
+    size_t binCount() const { return bins_.size(); }
+
+    const Bin& bin(uint32_t id) const { return bins_[id]; }
+    uint32_t pixelBin(size_t pixelIndex) const { return pixelBin_[pixelIndex]; }
+
+    uint32_t cellBegin(int cx, int cy) const { return cellStart_[cellIndex(cx, cy)]; }
+    uint32_t cellEnd(int cx, int cy) const { return cellStart_[cellIndex(cx, cy) + 1]; }
+
+    int cellOf(float coordinate, int cells) const {
+        return std::min(cells - 1, std::max(0, static_cast<int>(coordinate) / cellSize_));
+    }
+
+    // Bin that a joint-domain point falls into, or kNoBin if it's empty
+    uint32_t find(const Feature& f) const {
+        size_t cell = cellIndex(cellOf(f.x, cellsX_), cellOf(f.y, cellsY_));
+        uint32_t key = colorKey(f.r, f.g, f.b);
+        auto begin = keys_.begin() + cellStart_[cell];
+        auto end = keys_.begin() + cellStart_[cell + 1];
+        auto it = std::lower_bound(begin, end, key);
+        return it != end && *it == key ? static_cast<uint32_t>(it - keys_.begin()) : kNoBin;
+    }
+
+private:
+    int cellSize_;
+    float colorStep_;
+    int cellsX_;
+    int cellsY_;
+    std::vector<uint32_t> cellStart_;
+    std::vector<uint32_t> keys_;
+    std::vector<Bin> bins_;
+    std::vector<uint32_t> pixelBin_;
+
+    size_t cellIndex(int cx, int cy) const { return static_cast<size_t>(cy) * cellsX_ + cx; }
+
+    uint32_t colorKey(float r, float g, float b) const {
+        auto level = [this](float c) {
+            return static_cast<uint32_t>(std::min(255.0f, std::max(0.0f, c / colorStep_)));
+        };
+        return level(r) << 16 | level(g) << 8 | level(b);
+    }
+
+    // Bins of one row of cells; pixelBin_ holds ids relative to the row
+    struct RowBins {
+        std::vector<uint32_t> cellCounts;
+        std::vector<uint32_t> keys;
+        std::vector<Bin> bins;
+    };
+
+    RowBins buildRow(const Image& image, int cy) {
+        RowBins row;
+        row.cellCounts.resize(cellsX_);
+        int y0 = cy * cellSize_;
+        int y1 = std::min(image.getHeight(), y0 + cellSize_);
+        std::vector<uint32_t> cellKeys;
+
+        for (int cx = 0; cx < cellsX_; ++cx) {
+            int x0 = cx * cellSize_;
+            int x1 = std::min(image.getWidth(), x0 + cellSize_);
+
+            cellKeys.clear();
+            for (int y = y0; y < y1; ++y) {
+                for (int x = x0; x < x1; ++x) {
+                    const Color& c = image.at(x, y);
+                    cellKeys.push_back(colorKey(c.r, c.g, c.b));
+                }
+            }
+            std::vector<uint32_t> unique = cellKeys;
+            std::sort(unique.begin(), unique.end());
+            unique.erase(std::unique(unique.begin(), unique.end()), unique.end());
+
+            uint32_t base = static_cast<uint32_t>(row.bins.size());
+            std::vector<double> sums(unique.size() * 5, 0.0);
+            std::vector<uint32_t> counts(unique.size(), 0);
+            size_t k = 0;
+            for (int y = y0; y < y1; ++y) {
+                for (int x = x0; x < x1; ++x, ++k) {
+                    size_t local = std::lower_bound(unique.begin(), unique.end(), cellKeys[k]) - unique.begin();
+                    const Color& c = image.at(x, y);
+                    double* s = &sums[local * 5];
+                    s[0] += x;
+                    s[1] += y;
+                    s[2] += c.r;
+                    s[3] += c.g;
+                    s[4] += c.b;
+                    counts[local]++;
+                    pixelBin_[image.getIndex(x, y)] = base + static_cast<uint32_t>(local);
+                }
+            }
+
+            for (size_t i = 0; i < unique.size(); ++i) {
+                const double* s = &sums[i * 5];
+                double n = counts[i];
+                Bin bin;
+                bin.mean = {static_cast<float>(s[0] / n), static_cast<float>(s[1] / n),
+                            static_cast<float>(s[2] / n), static_cast<float>(s[3] / n),
+                            static_cast<float>(s[4] / n)};
+                bin.count = counts[i];
+                row.bins.push_back(bin);
+                row.keys.push_back(unique[i]);
+            }
+            row.cellCounts[cx] = static_cast<uint32_t>(unique.size());
+        }
+        return row;
+    }
+
+    void build(const Image& image, ThreadPool& pool) {
+        std::vector<std::future<RowBins>> rows;
+        for (int cy = 0; cy < cellsY_; ++cy) {
+            rows.push_back(pool.submit([this, &image, cy]() { return buildRow(image, cy); }));
+        }
+
+        std::vector<uint32_t> rowBase(cellsY_);
+        cellStart_.assign(static_cast<size_t>(cellsX_) * cellsY_ + 1, 0);
+        for (int cy = 0; cy < cellsY_; ++cy) {
+            RowBins row = rows[cy].get();
+            rowBase[cy] = static_cast<uint32_t>(bins_.size());
+            for (int cx = 0; cx < cellsX_; ++cx) {
+                cellStart_[cellIndex(cx, cy) + 1] = cellStart_[cellIndex(cx, cy)] + row.cellCounts[cx];
+            }
+            keys_.insert(keys_.end(), row.keys.begin(), row.keys.end());
+            bins_.insert(bins_.end(), row.bins.begin(), row.bins.end());
+        }
+
+        // Make the per-row bin ids global
+        std::vector<std::future<void>> rebases;
+        for (int cy = 1; cy < cellsY_; ++cy) {
+            rebases.push_back(pool.submit([this, &image, &rowBase, cy]() {
+                int y1 = std::min(image.getHeight(), (cy + 1) * cellSize_);
+                for (int y = cy * cellSize_; y < y1; ++y) {
+                    uint32_t* row = pixelBin_.data() + image.getIndex(0, y);
+                    for (int x = 0; x < image.getWidth(); ++x) {
+                        row[x] += rowBase[cy];
+                    }
+                }
+            }));
+        }
+        for (auto& rebase : rebases) {
+            rebase.get();
+        }
+    }
+};
+
+} // namespace
+
+MeanShiftSegmenter::MeanShiftSegmenter(const Image& image, double colorBandwidth,
+                                     double spatialBandwidth, int maxRegionSize)
+    : RegionGrower(image, 0.0, maxRegionSize), colorBandwidth_(colorBandwidth),
+      spatialBandwidth_(spatialBandwidth), spatialScale_(std::max(image.getWidth(), image.getHeight())) {
+}
+
+void MeanShiftSegmenter::segment() {
+    // Bandwidths in pixels and 0-255 color units
+    float spatialBandwidth = std::max(1.0f, static_cast<float>(spatialBandwidth_ * spatialScale_));
+    float colorBandwidth = std::max(1.0f, static_cast<float>(colorBandwidth_ * 255.0));
+    float invSpatial2 = 1.0f / (spatialBandwidth * spatialBandwidth);
+    float invColor2 = 1.0f / (colorBandwidth * colorBandwidth);
+
+    // Half-bandwidth cells keep the bin approximation fine enough while a
+    // kernel window still spans only a few cells in each direction
+    ThreadPool pool(threadCount_);
+    int cellSize = std::max(1, static_cast<int>(spatialBandwidth / 2));
+    SpatialColorGrid grid(image_, cellSize, std::max(1.0f, colorBandwidth / 2), pool);
+    int reach = static_cast<int>(std::ceil(spatialBandwidth / cellSize));
+
+    size_t binCount = grid.binCount();
+    std::vector<Feature> modes(binCount);
+
+    // Bins are processed in waves of growing size (1/16, 1/16, 1/8, 1/4 and
+    // 1/2 of all bins, interleaved by id). A bin may take over the mode of any
+    // bin from an earlier wave, so the result doesn't depend on threading.
+    constexpr int kWaves = 5;
+    auto waveOf = [](uint32_t id) {
+        uint32_t r = id % 16;
+        if (r == 0) {
+            return 0;
+        }
+        int trailingZeros = 0;
+        while ((r & 1u) == 0) {
+            r >>= 1;
+            ++trailingZeros;
+        }
+        return kWaves - 1 - trailingZeros;
+    };
+
+    // Mode seeking from a bin's mean with a flat kernel. When the path
+    // enters a bin whose mode is already known, that mode is taken over.
+    auto seek = [&](uint32_t id, int wave) {
+        Feature p = grid.bin(id).mean;
+        for (int iteration = 0; iteration < kMaxIterations; ++iteration) {
+            int cx = grid.cellOf(p.x, grid.cellsX());
+            int cy = grid.cellOf(p.y, grid.cellsY());
+            double sx = 0, sy = 0, sr = 0, sg = 0, sb = 0, weight = 0;
+
+            for (int ny = std::max(0, cy - reach); ny <= std::min(grid.cellsY() - 1, cy + reach); ++ny) {
+                for (int nx = std::max(0, cx - reach); nx <= std::min(grid.cellsX() - 1, cx + reach); ++nx) {
+                    for (uint32_t j = grid.cellBegin(nx, ny); j < grid.cellEnd(nx, ny); ++j) {
+                        const Bin& bin = grid.bin(j);
+                        if (normalizedDistance(p, bin.mean, invSpatial2, invColor2) > 1.0f) {
+                            continue;
+                        }
+                        double w = bin.count;
+                        sx += w * bin.mean.x;
+                        sy += w * bin.mean.y;
+                        sr += w * bin.mean.r;
+                        sg += w * bin.mean.g;
+                        sb += w * bin.mean.b;
+                        weight += w;
+                    }
+                }
+            }
+            if (weight == 0) {
+                break;
+            }
+
+            Feature next = {static_cast<float>(sx / weight), static_cast<float>(sy / weight),
+                            static_cast<float>(sr / weight), static_cast<float>(sg / weight),
+                            static_cast<float>(sb / weight)};
+            float shift = normalizedDistance(p, next, invSpatial2, invColor2);
+            p = next;
+            if (shift < kConvergence) {
+                break;
+            }
+
+            uint32_t reached = grid.find(p);
+            if (reached != kNoBin && waveOf(reached) < wave) {
+                p = modes[reached];
+                break;
+            }
+        }
+        modes[id] = p;
+    };
+
+    std::vector<uint32_t> waveBins;
+    for (int wave = 0; wave < kWaves; ++wave) {
+        waveBins.clear();
+        for (uint32_t id = 0; id < binCount; ++id) {
+            if (waveOf(id) == wave) {
+                waveBins.push_back(id);
+            }
+        }
+
+        // Seeds in chunks across the pool
+        size_t chunkCount = static_cast<size_t>(pool.size()) * 8;
+        size_t chunkSize = std::max<size_t>(1, (waveBins.size() + chunkCount - 1) / chunkCount);
+        std::vector<std::future<void>> chunks;
+        for (size_t begin = 0; begin < waveBins.size(); begin += chunkSize) {
+            size_t end = std::min(waveBins.size(), begin + chunkSize);
+            chunks.push_back(pool.submit([&seek, &waveBins, wave, begin, end]() {
+                for (size_t i = begin; i < end; ++i) {
+                    seek(waveBins[i], wave);
+                }
+            }));
+        }
+        for (auto& chunk : chunks) {
+            chunk.get();
+        }
+    }
+
+    // Merge bins whose modes ended up close: against bins of the same and
+    // adjacent cells, and against the bin each mode lies in
+    float mergeDistance2 = kMergeDistance * kMergeDistance;
+    DisjointSet sets(binCount);
+    for (int cy = 0; cy < grid.cellsY(); ++cy) {
+        for (int cx = 0; cx < grid.cellsX(); ++cx) {
+            for (uint32_t i = grid.cellBegin(cx, cy); i < grid.cellEnd(cx, cy); ++i) {
+                for (int ny = std::max(0, cy - 1); ny <= std::min(grid.cellsY() - 1, cy + 1); ++ny) {
+                    for (int nx = std::max(0, cx - 1); nx <= std::min(grid.cellsX() - 1, cx + 1); ++nx) {
+                        for (uint32_t j = std::max(i + 1, grid.cellBegin(nx, ny)); j < grid.cellEnd(nx, ny); ++j) {
+                            if (normalizedDistance(modes[i], modes[j], invSpatial2, invColor2) < mergeDistance2) {
+                                sets.unite(i, j);
+                            }
+                        }
+                    }
+                }
+                uint32_t home = grid.find(modes[i]);
+                if (home != kNoBin &&
+                    normalizedDistance(modes[i], modes[home], invSpatial2, invColor2) < mergeDistance2) {
+                    sets.unite(i, home);
+                }
+            }
+        }
+    }
+
+    std::vector<uint32_t> modeId(binCount, kNoBin);
+    uint32_t modeCount = 0;
+    for (uint32_t id = 0; id < binCount; ++id) {
+        uint32_t root = sets.find(id);
+        if (modeId[root] == kNoBin) {
+            modeId[root] = modeCount++;
+        }
+        modeId[id] = modeId[root];
+    }
+
+    modeLabels_.resize(image_.getPixelCount());
+    for (size_t i = 0; i < modeLabels_.size(); ++i) {
+        modeLabels_[i] = modeId[grid.pixelBin(i)];
+    }
+
+    binCount_ = binCount;
+    modeCount_ = modeCount;
+    segmented_ = true;
+}
+
+RegionView MeanShiftSegmenter::appendRegion(int seedX, int seedY, const LabelMap& labels, RegionBuffer& out) {
+    if (!segmented_) {
+        segment();
+    }
+    if (connectivity_ == Connectivity::FOUR) {
+        return floodRegion<Connectivity::FOUR>(seedX, seedY, labels, out);
+    }
+    return floodRegion<Connectivity::EIGHT>(seedX, seedY, labels, out);
+}
+
+template <Connectivity C>
+RegionView MeanShiftSegmenter::floodRegion(int seedX, int seedY, const LabelMap& labels, RegionBuffer& out) {
+    if (inRegion_.size() != bounds_.area()) {
+        inRegion_.resize(bounds_.area());
+    }
+    inRegion_.nextGeneration();
+
+    uint32_t mode = modeLabels_[image_.getIndex(seedX, seedY)];
+    size_t maxSize = maxRegionSize_ > 0 ? static_cast<size_t>(maxRegionSize_) : SIZE_MAX;
+
+    // The region's slice of the output doubles as the breadth-first queue
+    uint32_t offset = out.size();
+    auto regionSize = [&]() { return static_cast<size_t>(out.size() - offset); };
+    out.push(imageIndex(seedX, seedY));
+    inRegion_.mark(localIndex(seedX, seedY));
+    lastStats_.reset();
+    lastStats_.add(seedX, seedY, image_.at(seedX, seedY));
+    lastTruncated_ = false;
+
+    for (uint32_t head = offset; head < out.size() && !lastTruncated_; ++head) {
+        int x = static_cast<int>(out[head] % width_);
+        int y = static_cast<int>(out[head] / width_);
+        forEachNeighbor<C>(x, y, [&](int nx, int ny) {
+            size_t index = localIndex(nx, ny);
+            if (lastTruncated_ || inRegion_.test(index) || labels.isAssigned(nx, ny) ||
+                modeLabels_[image_.getIndex(nx, ny)] != mode) {
+                return;
+            }
+            if (regionSize() >= maxSize) {
+                lastTruncated_ = true;
+                return;
+            }
+            inRegion_.mark(index);
+            out.push(imageIndex(nx, ny));
+            lastStats_.add(nx, ny, image_.at(nx, ny));
+        });
+    }
+
+    return out.since(offset);
+}
+
+} // namespace ic
@@ -0,0 +1,38 @@
+#include "algorithms/region_grower.hpp"
+
+namespace ic {
+
+RegionGrower::RegionGrower(const Image& image, double similarityThreshold, int maxRegionSize)
+    : image_(image), similarityThreshold_(similarityThreshold), maxRegionSize_(maxRegionSize),
+      width_(image.getWidth()), height_(image.getHeight()),
+      bounds_(0, 0, image.getWidth(), image.getHeight()) {
+}
+
+std::vector<Point> RegionGrower::findRegion(int seedX, int seedY, const LabelMap& labels) {
+    RegionBuffer buffer;
+    RegionView view = appendRegion(seedX, seedY, labels, buffer);
+
+    std::vector<Point> points;
+    points.reserve(view.length);
+    for (uint32_t index : buffer.indices(view)) {
+        points.emplace_back(static_cast<int>(index % width_), static_cast<int>(index / width_));
+    }
+    return points;
+}
+
+std::vector<Point> RegionGrower::getNeighbors(int x, int y, bool include8Connected) const {
+    std::vector<Point> neighbors;
+    neighbors.reserve(include8Connected ? 8 : 4);
+
+    auto add = [&neighbors](int nx, int ny) { neighbors.emplace_back(nx, ny); };
+    if (include8Connected) {
+        forEachNeighbor<Connectivity::EIGHT>(x, y, add);
+    }
+    else {
+        forEachNeighbor<Connectivity::FOUR>(x, y, add);
+    }
+
+    return neighbors;
+}
+
+} // namespace ic
@@ -0,0 +1,150 @@
+#include "algorithms/seed_scheduler.hpp"
+#include "utils/metrics.hpp"
+#include <algorithm>
+#include <cstdlib>
+
+namespace ic {
+
+namespace {
+
+int colorL1(const Color& a, const Color& b) {
+    return std::abs(a.r - b.r) + std::abs(a.g - b.g) + std::abs(a.b - b.b);
+}
+
+} // namespace
+
+GradientMap::GradientMap(const Image& image) : width_(image.getWidth()) {
+    // Per-image precomputation, like the summed-area tables
+    metrics::ScopedTimer timer(metrics::Phase::LOCAL_STATS);
+    int height = image.getHeight();
+    metrics::count(metrics::Counter::BYTES_ALLOCATED, static_cast<size_t>(width_) * height * sizeof(uint16_t));
+    values_.resize(static_cast<size_t>(width_) * height);
+
+    for (int y = 0; y < height; ++y) {
+        Span<const Color> row = image.row(y);
+        Span<const Color> below = image.row(std::min(y + 1, height - 1));
+        uint16_t* out = values_.data() + static_cast<size_t>(y) * width_;
+        for (int x = 0; x < width_; ++x) {
+            int right = std::min(x + 1, width_ - 1);
+            out[x] = static_cast<uint16_t>(colorL1(row[x], row[right]) + colorL1(row[x], below[x]));
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// RasterSeedScheduler
+// ---------------------------------------------------------------------------
+
+void RasterSeedScheduler::reset(const Rect& bounds) {
+    bounds_ = bounds;
+    x_ = bounds.x;
+    y_ = bounds.y;
+}
+
+bool RasterSeedScheduler::next(int& x, int& y) {
+    if (y_ >= bounds_.y + bounds_.height || bounds_.width <= 0) {
+        return false;
+    }
+    x = x_;
+    y = y_;
+    if (++x_ == bounds_.x + bounds_.width) {
+        x_ = bounds_.x;
+        ++y_;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// GradientSeedScheduler
+// ---------------------------------------------------------------------------
+
+GradientSeedScheduler::GradientSeedScheduler(std::shared_ptr<const GradientMap> gradient)
+    : gradient_(std::move(gradient)) {}
+
+void GradientSeedScheduler::reset(const Rect& bounds) {
+    const GradientMap& gradient = *gradient_;
+    uint32_t width = static_cast<uint32_t>(gradient.getWidth());
+
+    counts_.assign(GradientMap::kMaxValue + 2, 0);
+    for (int y = bounds.y; y < bounds.y + bounds.height; ++y) {
+        for (int x = bounds.x; x < bounds.x + bounds.width; ++x) {
+            ++counts_[gradient.at(x, y) + 1];
+        }
+    }
+    for (size_t i = 1; i < counts_.size(); ++i) {
+        counts_[i] += counts_[i - 1];
+    }
+
+    order_.resize(bounds.area());
+    for (int y = bounds.y; y < bounds.y + bounds.height; ++y) {
+        for (int x = bounds.x; x < bounds.x + bounds.width; ++x) {
+            order_[counts_[gradient.at(x, y)]++] = static_cast<uint32_t>(y) * width + static_cast<uint32_t>(x);
+        }
+    }
+    position_ = 0;
+}
+
+bool GradientSeedScheduler::next(int& x, int& y) {
+    if (position_ == order_.size()) {
+        return false;
+    }
+    uint32_t index = order_[position_++];
+    uint32_t width = static_cast<uint32_t>(gradient_->getWidth());
+    x = static_cast<int>(index % width);
+    y = static_cast<int>(index / width);
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// GridSeedScheduler
+// ---------------------------------------------------------------------------
+
+GridSeedScheduler::GridSeedScheduler(std::shared_ptr<const GradientMap> gradient, int spacing)
+    : gradient_(std::move(gradient)), spacing_(std::max(1, spacing)) {}
+
+void GridSeedScheduler::reset(const Rect& bounds) {
+    gridSeeds_.clear();
+    for (int cy = bounds.y; cy < bounds.y + bounds.height; cy += spacing_) {
+        for (int cx = bounds.x; cx < bounds.x + bounds.width; cx += spacing_) {
+            int cellRight = std::min(cx + spacing_, bounds.x + bounds.width);
+            int cellBottom = std::min(cy + spacing_, bounds.y + bounds.height);
+
+            // Without a gradient map, the cell center
+            Point best((cx + cellRight) / 2, (cy + cellBottom) / 2);
+            if (gradient_) {
+                uint16_t lowest = gradient_->at(best.x, best.y);
+                for (int y = cy; y < cellBottom; ++y) {
+                    for (int x = cx; x < cellRight; ++x) {
+                        if (gradient_->at(x, y) < lowest) {
+                            lowest = gradient_->at(x, y);
+                            best = Point(x, y);
+                        }
+                    }
+                }
+            }
+            gridSeeds_.push_back(best);
+        }
+    }
+    position_ = 0;
+    raster_.reset(bounds);
+}
+
+bool GridSeedScheduler::next(int& x, int& y) {
+    if (position_ < gridSeeds_.size()) {
+        x = gridSeeds_[position_].x;
+        y = gridSeeds_[position_].y;
+        ++position_;
+        return true;
+    }
+    return raster_.next(x, y);
+}
+
+std::unique_ptr<SeedScheduler> createSeedScheduler(SeedOrder order, std::shared_ptr<const GradientMap> gradient) {
+    switch (order) {
+        case SeedOrder::GRADIENT: return std::make_unique<GradientSeedScheduler>(std::move(gradient));
+        case SeedOrder::GRID: return std::make_unique<GridSeedScheduler>(std::move(gradient));
+        default: return std::make_unique<RasterSeedScheduler>();
+    }
+}
+
+} // namespace ic
@@ -0,0 +1,132 @@
+#include "algorithms/union_find_segmenter.hpp"
+#include "utils/disjoint_set.hpp"
+#include "utils/region_sums.hpp"
+
+namespace ic {
+
+UnionFindSegmenter::UnionFindSegmenter(const Image& image, double similarityThreshold, int maxRegionSize)
+    : image_(image), similarityThreshold_(similarityThreshold), maxRegionSize_(maxRegionSize) {
+}
+
+void UnionFindSegmenter::segment(LabelMap& labels, std::vector<Color>& regionColors,
+                                 std::vector<int>& regionSizes) {
+    if (distanceMode_ == DistanceMode::TABLE) {
+        const ColorTables& tables = ColorTables::instance();
+        int32_t bound = ColorTables::similarityToSquaredThreshold(similarityThreshold_);
+        auto similar = [&tables, bound](const Color& a, const Color& b) {
+            return tables.squaredDistance(a, b) <= bound;
+        };
+        if (connectivity_ == Connectivity::FOUR) {
+            labelPixels<Connectivity::FOUR>(labels, regionColors, regionSizes, similar);
+        }
+        else {
+            labelPixels<Connectivity::EIGHT>(labels, regionColors, regionSizes, similar);
+        }
+        return;
+    }
+
+    double threshold = similarityThreshold_;
+    auto similar = [threshold](const Color& a, const Color& b) {
+        return colorSimilarity(a, b) >= threshold;
+    };
+    if (connectivity_ == Connectivity::FOUR) {
+        labelPixels<Connectivity::FOUR>(labels, regionColors, regionSizes, similar);
+    }
+    else {
+        labelPixels<Connectivity::EIGHT>(labels, regionColors, regionSizes, similar);
+    }
+}
+
+template <Connectivity C, typename Similar>
+void UnionFindSegmenter::labelPixels(LabelMap& labels, std::vector<Color>& regionColors,
+                                     std::vector<int>& regionSizes, Similar similar) {
+    // Previously visited neighbors: W, NW, N, NE (or W, N)
+    static const int eightConnected[4][2] = {{-1, 0}, {-1, -1}, {0, -1}, {1, -1}};
+    static const int fourConnected[2][2] = {{-1, 0}, {0, -1}};
+    const int (*offsets)[2] = C == Connectivity::EIGHT ? eightConnected : fourConnected;
+    constexpr int count = C == Connectivity::EIGHT ? 4 : 2;
+
+    int width = image_.getWidth();
+    int height = image_.getHeight();
+    labels.reset(width, height);
+
+    // Provisional component per pixel, merged as the scan goes
+    DisjointSet sets;
+    std::vector<RegionSums> sums;
+    uint64_t cap = maxRegionSize_ > 0 ? static_cast<uint64_t>(maxRegionSize_) : UINT64_MAX;
+
+    for (int y = 0; y < height; ++y) {
+        Span<const Color> row = image_.row(y);
+        for (int x = 0; x < width; ++x) {
+            const Color& color = row[x];
+            uint32_t label = LabelMap::kUnassigned;
+
+            for (int n = 0; n < count; ++n) {
+                int nx = x + offsets[n][0];
+                int ny = y + offsets[n][1];
+                if (nx < 0 || ny < 0 || nx >= width) {
+                    continue;
+                }
+
+                uint32_t neighbor = sets.find(labels.get(nx, ny));
+                if (label == LabelMap::kUnassigned) {
+                    // Join the pixel to the neighbor's component
+                    Color other = runningMean_ ? sums[neighbor].mean() : image_.at(nx, ny);
+                    if (sums[neighbor].count + 1 <= cap && similar(color, other)) {
+                        label = neighbor;
+                        sums[neighbor].add(color);
+                    }
+                    continue;
+                }
+
+                // Already joined: this pixel may bridge two components
+                uint32_t own = sets.find(label);
+                if (own == neighbor) {
+                    continue;
+                }
+                bool bridge = runningMean_ ? similar(sums[own].mean(), sums[neighbor].mean())
+                                           : similar(color, image_.at(nx, ny));
+                if (bridge && static_cast<uint64_t>(sums[own].count) + sums[neighbor].count <= cap) {
+                    uint32_t root = sets.unite(own, neighbor);
+                    sums[root].merge(sums[root == own ? neighbor : own]);
+                }
+            }
+
+            if (label == LabelMap::kUnassigned) {
+                label = sets.add();
+                sums.emplace_back();
+                sums.back().add(color);
+            }
+            labels.set(x, y, label);
+        }
+    }
+
+    // Dense ids in raster order of first appearance
+    std::vector<uint32_t> finalId(sums.size(), LabelMap::kUnassigned);
+    regionColors.clear();
+    regionSizes.clear();
+    for (size_t i = 0; i < labels.size(); ++i) {
+        uint32_t root = sets.find(labels[i]);
+        if (finalId[root] == LabelMap::kUnassigned) {
+            finalId[root] = static_cast<uint32_t>(regionColors.size());
+            regionColors.push_back(sums[root].mean());
+            regionSizes.push_back(static_cast<int>(sums[root].count));
+        }
+        labels[i] = finalId[root];
+    }
+}
+
+bool UnionFindBackend::segment(const SegmentationRequest& request, LabelMap& labels,
+                               std::vector<Color>& regionColors, std::vector<int>& regionSizes) {
+    UnionFindSegmenter segmenter(*request.image, request.similarityThreshold, request.maxRegionSize);
+    segmenter.setRunningMean(request.runningMean);
+    segmenter.setConnectivity(request.connectivity);
+    segmenter.setDistanceMode(request.distanceMode);
+    segmenter.segment(labels, regionColors, regionSizes);
+    if (request.progress) {
+        request.progress->add(static_cast<int64_t>(labels.size()), static_cast<int64_t>(regionSizes.size()));
+    }
+    return true;
+}
+
+} // namespace ic
@@ -0,0 +1,294 @@
+#include "batch_processor.hpp"
+#include "utils/bounded_queue.hpp"
+#include "utils/row_io.hpp"
+#include "utils/thread_pool.hpp"
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <filesystem>
+#include <thread>
+#include <atomic>
+#include <cmath>
+
+namespace ic {
+
+// ---------------------------------------------------------------------------
+// BatchStats
+// ---------------------------------------------------------------------------
+
+void BatchStats::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    startTime_ = std::chrono::high_resolution_clock::now();
+    totalPixels_ = 0;
+    totalRegions_ = 0;
+    failures_ = 0;
+    latencies_.clear();
+}
+
+void BatchStats::finish() {
+    endTime_ = std::chrono::high_resolution_clock::now();
+}
+
+void BatchStats::addImage(int64_t pixels, int regions, double latencySeconds) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    totalPixels_ += pixels;
+    totalRegions_ += regions;
+    latencies_.push_back(latencySeconds);
+}
+
+void BatchStats::addFailure() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    failures_++;
+}
+
+double BatchStats::percentile(double fraction) const {
+    if (latencies_.empty()) {
+        return 0.0;
+    }
+    // Nearest-rank percentile
+    std::vector<double> sorted = latencies_;
+    std::sort(sorted.begin(), sorted.end());
+    size_t rank = static_cast<size_t>(std::ceil(fraction * sorted.size()));
+    return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+std::unordered_map<std::string, double> BatchStats::getSummary() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    double elapsed = std::chrono::duration<double>(endTime_ - startTime_).count();
+    double images = static_cast<double>(latencies_.size());
+
+    return {
+        {"images", images},
+        {"failures", static_cast<double>(failures_)},
+        {"elapsed_time", elapsed},
+        {"images_per_second", elapsed > 0.0 ? images / elapsed : 0.0},
+        {"processing_rate", elapsed > 0.0 ? totalPixels_ / elapsed : 0.0},
+        {"total_pixels", static_cast<double>(totalPixels_)},
+        {"total_regions", static_cast<double>(totalRegions_)},
+        {"latency_p50", percentile(0.50)},
+        {"latency_p99", percentile(0.99)}
+    };
+}
+
+void BatchStats::printReport() const {
+    auto summary = getSummary();
+    std::string line(60, '=');
+
+    std::cout << std::endl << line << std::endl;
+    std::cout << std::string(22, ' ') << "BATCH REPORT" << std::endl;
+    std::cout << line << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Images compressed:   " << static_cast<int>(summary["images"])
+              << " (" << static_cast<int>(summary["failures"]) << " failed)" << std::endl;
+    std::cout << "Total time:          " << summary["elapsed_time"] << " seconds" << std::endl;
+    std::cout << "Throughput:          " << summary["images_per_second"] << " images/second" << std::endl;
+    std::cout << "Processing rate:     " << std::setprecision(0) << summary["processing_rate"] << " pixels/second" << std::endl;
+    std::cout << "Regions identified:  " << static_cast<int64_t>(summary["total_regions"]) << std::endl;
+    std::cout << std::setprecision(3);
+    std::cout << "Latency p50:         " << summary["latency_p50"] << " seconds" << std::endl;
+    std::cout << "Latency p99:         " << summary["latency_p99"] << " seconds" << std::endl;
+    std::cout << line << std::endl;
+    std::cout.unsetf(std::ios_base::floatfield);
+}
+
+// ---------------------------------------------------------------------------
+// BatchProcessor
+// ---------------------------------------------------------------------------
+
+namespace {
+
+using Clock = std::chrono::high_resolution_clock;
+
+struct DecodedImage {
+    std::string path;
+    std::shared_ptr<Image> image;
+    Clock::time_point started;
+};
+
+struct CompressedImage {
+    std::string path;
+    ImageCompressor::Result result;
+    Clock::time_point started;
+};
+
+bool hasImageExtension(const std::filesystem::path& path) {
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    static const char* known[] = {".jpg", ".jpeg", ".png", ".bmp", ".tga", ".gif", ".ppm", ".pgm", ".psd", ".hdr",
+                                  ".raw", ".rgb"};
+    return std::find(std::begin(known), std::end(known), extension) != std::end(known);
+}
+
+} // namespace
+
+BatchProcessor::BatchProcessor(CompressorFactory factory, BatchOptions options)
+    : factory_(std::move(factory)), options_(std::move(options)) {
+}
+
+std::vector<std::string> BatchProcessor::listImages(const std::string& directory) {
+    std::vector<std::string> images;
+    for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+        if (entry.is_regular_file() && hasImageExtension(entry.path())) {
+            images.push_back(entry.path().string());
+        }
+    }
+    std::sort(images.begin(), images.end());
+    return images;
+}
+
+std::string BatchProcessor::outputPathFor(const std::string& inputPath) const {
+    std::filesystem::path input(inputPath);
+    std::filesystem::path directory = options_.outputDir.empty() ? input.parent_path()
+                                                                 : std::filesystem::path(options_.outputDir);
+    std::string extension = options_.outputExtension.empty() ? input.extension().string() : options_.outputExtension;
+    std::string name = input.stem().string() + options_.outputSuffix + extension;
+    return (directory / name).string();
+}
+
+void BatchProcessor::log(const std::string& message) {
+    std::lock_guard<std::mutex> lock(logMutex_);
+    std::cout << message << std::endl;
+}
+
+bool BatchProcessor::run(const std::vector<std::string>& inputs) {
+    if (!options_.outputDir.empty() && !options_.reportOnly) {
+        std::filesystem::create_directories(options_.outputDir);
+    }
+
+    int decodeWorkers = std::max(1, options_.decodeWorkers);
+    int compressWorkers = ThreadPool::resolveThreadCount(options_.compressWorkers);
+    // Report-only runs have no encode stage
+    int encodeWorkers = options_.reportOnly ? 0 : std::max(1, options_.encodeWorkers);
+
+    BoundedQueue<DecodedImage> decoded(options_.queueDepth);
+    BoundedQueue<CompressedImage> compressed(options_.queueDepth);
+
+    // The last worker of a stage to finish closes the queue it feeds
+    std::atomic<size_t> nextInput{0};
+    std::atomic<int> decodersLeft{decodeWorkers};
+    std::atomic<int> compressorsLeft{compressWorkers};
+    std::atomic<int> completed{0};
+
+    stats_.start();
+
+    auto fail = [this](const std::string& path, const std::string& reason) {
+        stats_.addFailure();
+        log("Failed: " + path + " (" + reason + ")");
+    };
+    auto succeed = [&](const std::string& path, const std::string& outputPath, int64_t pixels, int regions,
+                       Clock::time_point started) {
+        double latency = std::chrono::duration<double>(Clock::now() - started).count();
+        stats_.addImage(pixels, regions, latency);
+
+        std::ostringstream message;
+        message << "[" << ++completed << "/" << inputs.size() << "] " << path << " -> "
+                << outputPath << " (" << regions << " regions, "
+                << std::fixed << std::setprecision(2) << latency << " s)";
+        log(message.str());
+    };
+
+    std::vector<std::thread> threads;
+
+    for (int i = 0; i < decodeWorkers; ++i) {
+        threads.emplace_back([&]() {
+            for (size_t index = nextInput++; index < inputs.size(); index = nextInput++) {
+                // The compressor's decode stage, as in single-image mode
+                DecodedImage item{inputs[index], nullptr, Clock::now()};
+                bool raw = isRawPath(item.path);
+                item.image = ImageCompressor::decodeImage(item.path, raw ? options_.rawWidth : 0,
+                                                          raw ? options_.rawHeight : 0);
+                if (!item.image) {
+                    fail(item.path, "could not decode");
+                    continue;
+                }
+                std::string path = item.path;
+                if (!decoded.push(std::move(item))) {
+                    fail(path, "pipeline closed");
+                }
+            }
+            if (--decodersLeft == 0) {
+                decoded.close();
+            }
+        });
+    }
+
+    for (int i = 0; i < compressWorkers; ++i) {
+        threads.emplace_back([&]() {
+            // A worker whose compressor can't be built fails its share of
+            // the images but still drains the queue, so the pipeline closes
+            std::unique_ptr<ImageCompressor> compressor;
+            std::string setupError;
+            try {
+                compressor = factory_();
+                compressor->setReportEnabled(false);
+            }
+            catch (const std::exception& e) {
+                compressor = nullptr;
+                setupError = e.what();
+            }
+
+            while (auto item = decoded.pop()) {
+                if (!compressor) {
+                    fail(item->path, setupError);
+                    continue;
+                }
+                try {
+                    int64_t pixels = static_cast<int64_t>(item->image->getWidth()) * item->image->getHeight();
+                    compressor->setImage(std::move(item->image));
+                    if (!compressor->compress()) {
+                        fail(item->path, "compression failed");
+                        continue;
+                    }
+                    if (options_.reportOnly) {
+                        succeed(item->path, "(not saved)", pixels,
+                                static_cast<int>(compressor->getRegionColors().size()), item->started);
+                        continue;
+                    }
+                    CompressedImage result{item->path, ImageCompressor::Result(), item->started};
+                    if (!compressor->copyResult(result.result)) {
+                        fail(item->path, "no compression result");
+                        continue;
+                    }
+                    if (!compressed.push(std::move(result))) {
+                        fail(item->path, "pipeline closed");
+                    }
+                }
+                catch (const std::exception& e) {
+                    fail(item->path, e.what());
+                }
+            }
+            if (--compressorsLeft == 0) {
+                compressed.close();
+            }
+        });
+    }
+
+    for (int i = 0; i < encodeWorkers; ++i) {
+        threads.emplace_back([&]() {
+            while (auto item = compressed.pop()) {
+                // The compressor's encode stage: .icr or rendered pixels,
+                // plus the metadata report
+                std::string outputPath = outputPathFor(item->path);
+                if (!ImageCompressor::saveResult(item->result, outputPath)) {
+                    fail(item->path, "could not write " + outputPath);
+                    continue;
+                }
+
+                const Image& image = *item->result.image;
+                succeed(item->path, outputPath, static_cast<int64_t>(image.getWidth()) * image.getHeight(),
+                        static_cast<int>(item->result.regionColors.size()), item->started);
+            }
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    stats_.finish();
+    return stats_.getFailureCount() == 0;
+}
+
+} // namespace ic
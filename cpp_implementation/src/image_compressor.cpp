@@ -0,0 +1,1544 @@
+#include "image_compressor.hpp"
+#include "algorithms/union_find_segmenter.hpp"
+#include "utils/region_graph.hpp"
+#include "utils/region_map.hpp"
+#include "utils/region_sums.hpp"
+#include "utils/thread_pool.hpp"
+#include "utils/disjoint_set.hpp"
+#include <cstring>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <numeric>
+#include <filesystem>
+#include <ctime>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace ic {
+
+namespace {
+
+// Physical memory not in use, or 0 when the platform doesn't say
+uint64_t availableMemoryBytes() {
+#ifdef _WIN32
+    MEMORYSTATUSEX status;
+    status.dwLength = sizeof(status);
+    return GlobalMemoryStatusEx(&status) ? static_cast<uint64_t>(status.ullAvailPhys) : 0;
+#elif defined(_SC_AVPHYS_PAGES)
+    long pages = sysconf(_SC_AVPHYS_PAGES);
+    long pageSize = sysconf(_SC_PAGESIZE);
+    return pages > 0 && pageSize > 0 ? static_cast<uint64_t>(pages) * static_cast<uint64_t>(pageSize) : 0;
+#else
+    return 0;
+#endif
+}
+
+// Name used on the command line and in reports
+const char* algorithmName(ImageCompressor::Algorithm algorithm) {
+    switch (algorithm) {
+        case ImageCompressor::Algorithm::MEAN_SHIFT: return "meanshift";
+        case ImageCompressor::Algorithm::UNION_FIND: return "unionfind";
+        default: return "adaptive";
+    }
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// CompressionStats
+// ---------------------------------------------------------------------------
+
+CompressionStats::CompressionStats() = default;
+
+void CompressionStats::start(int width, int height) {
+    startTime_ = std::chrono::high_resolution_clock::now();
+    finished_ = false;
+    width_ = width;
+    height_ = height;
+    totalPixels_ = static_cast<int64_t>(width) * height;
+    bytesOriginal_ = static_cast<int64_t>(width) * height * 3; // 3 bytes per pixel (RGB)
+}
+
+void CompressionStats::finish() {
+    endTime_ = std::chrono::high_resolution_clock::now();
+    finished_ = true;
+
+    if (!regionSizes_.empty()) {
+        largestRegion_ = *std::max_element(regionSizes_.begin(), regionSizes_.end());
+        smallestRegion_ = *std::min_element(regionSizes_.begin(), regionSizes_.end());
+        int64_t total = std::accumulate(regionSizes_.begin(), regionSizes_.end(), int64_t(0));
+        avgRegionSize_ = static_cast<double>(total) / regionSizes_.size();
+    }
+
+    // Estimate compressed size: 3 bytes for color + 4 bytes per pixel coordinate pair
+    bytesCompressed_ = static_cast<int64_t>(totalRegions_) * 3 + 4 * static_cast<int64_t>(processedPixels_);
+}
+
+void CompressionStats::addRegion(const std::vector<Point>& region) {
+    addRegion(static_cast<int>(region.size()));
+}
+
+void CompressionStats::addRegion(int regionSize) {
+    regionSizes_.push_back(regionSize);
+    processedPixels_ += regionSize;
+    totalRegions_++;
+}
+
+void CompressionStats::setRegionSizes(std::vector<int> regionSizes) {
+    regionSizes_ = std::move(regionSizes);
+    totalRegions_ = static_cast<int>(regionSizes_.size());
+    processedPixels_ = std::accumulate(regionSizes_.begin(), regionSizes_.end(), int64_t(0));
+}
+
+void CompressionStats::setPyramidStats(int levels, int64_t refinedPixels) {
+    pyramidLevels_ = levels;
+    refinedPixels_ = refinedPixels;
+}
+
+void CompressionStats::setRegionSizeCap(int cap, int64_t truncatedRegions) {
+    regionSizeCap_ = cap;
+    truncatedRegions_ = truncatedRegions;
+}
+
+void CompressionStats::setSequenceStats(int frame, int64_t regrownPixels) {
+    sequenceFrame_ = frame;
+    regrownPixels_ = regrownPixels;
+}
+
+void CompressionStats::addThreadWork(int threadIndex, int64_t pixels, double busySeconds) {
+    if (threadIndex < 0) {
+        return;
+    }
+    if (threadWork_.size() <= static_cast<size_t>(threadIndex)) {
+        threadWork_.resize(threadIndex + 1);
+    }
+    threadWork_[threadIndex].pixels += pixels;
+    threadWork_[threadIndex].busySeconds += busySeconds;
+}
+
+void CompressionStats::setCacheStats(uint64_t hits, uint64_t misses) {
+    cacheHits_ = hits;
+    cacheMisses_ = misses;
+}
+
+double CompressionStats::getElapsedTime() const {
+    auto end = finished_ ? endTime_ : std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double>(end - startTime_).count();
+}
+
+double CompressionStats::getProgress() const {
+    if (totalPixels_ == 0) {
+        return 0.0;
+    }
+    return std::min(1.0, static_cast<double>(processedPixels_) / totalPixels_);
+}
+
+double CompressionStats::getProcessingRate() const {
+    double elapsed = getElapsedTime();
+    if (elapsed <= 0.0) {
+        return 0.0;
+    }
+    return processedPixels_ / elapsed;
+}
+
+std::unordered_map<std::string, double> CompressionStats::getSummary(bool detailed) const {
+    double elapsed = getElapsedTime();
+    double progress = getProgress();
+    double compressionRatio = static_cast<double>(totalPixels_) / std::max(1, totalRegions_);
+    double estimatedRemaining = progress >= 1.0 ? 0.0 : (elapsed / std::max(0.001, progress)) - elapsed;
+
+    std::unordered_map<std::string, double> summary = {
+        {"progress", progress},
+        {"elapsed_time", elapsed},
+        {"estimated_remaining", estimatedRemaining},
+        {"processing_rate", getProcessingRate()},
+        {"compression_ratio", compressionRatio},
+        {"total_pixels", static_cast<double>(totalPixels_)},
+        {"processed_pixels", static_cast<double>(processedPixels_)},
+        {"total_regions", static_cast<double>(totalRegions_)}
+    };
+
+    if (detailed) {
+        uint64_t lookups = cacheHits_ + cacheMisses_;
+        summary["largest_region"] = largestRegion_;
+        summary["smallest_region"] = regionSizes_.empty() ? 0 : smallestRegion_;
+        summary["avg_region_size"] = avgRegionSize_;
+        summary["bytes_original"] = static_cast<double>(bytesOriginal_);
+        summary["bytes_compressed"] = static_cast<double>(bytesCompressed_);
+        summary["byte_ratio"] = static_cast<double>(bytesOriginal_) / std::max<int64_t>(1, bytesCompressed_);
+        summary["cache_hits"] = static_cast<double>(cacheHits_);
+        summary["cache_misses"] = static_cast<double>(cacheMisses_);
+        summary["cache_hit_rate"] = lookups > 0 ? static_cast<double>(cacheHits_) / lookups : 0.0;
+        if (pyramidLevels_ > 0) {
+            summary["pyramid_levels"] = pyramidLevels_;
+            summary["refined_pixels"] = static_cast<double>(refinedPixels_);
+        }
+        summary["max_region_size"] = regionSizeCap_;
+        summary["truncated_regions"] = static_cast<double>(truncatedRegions_);
+        if (smallMerges_ > 0) {
+            summary["merged_small"] = smallMerges_;
+        }
+        if (targetMerges_ > 0) {
+            summary["merged_target"] = targetMerges_;
+        }
+        if (resultCacheState_ >= 0) {
+            summary["result_cache_hit"] = resultCacheState_;
+        }
+        if (sequenceFrame_ >= 0) {
+            summary["sequence_frame"] = sequenceFrame_;
+            summary["regrown_pixels"] = static_cast<double>(regrownPixels_);
+        }
+        for (size_t i = 0; i < metrics::kPhaseCount; ++i) {
+            metrics::Phase phase = static_cast<metrics::Phase>(i);
+            if (metrics_.calls(phase) > 0) {
+                std::string prefix = std::string("phase_") + metrics::phaseName(phase) + "_";
+                summary[prefix + "time"] = metrics_.seconds(phase);
+                summary[prefix + "calls"] = static_cast<double>(metrics_.calls(phase));
+            }
+        }
+        for (size_t i = 0; i < metrics::kCounterCount; ++i) {
+            metrics::Counter counter = static_cast<metrics::Counter>(i);
+            if (metrics_.count(counter) > 0) {
+                summary[std::string("counter_") + metrics::counterName(counter)] =
+                    static_cast<double>(metrics_.count(counter));
+            }
+        }
+        summary["threads"] = static_cast<double>(threadWork_.size());
+        for (size_t i = 0; i < threadWork_.size(); ++i) {
+            const ThreadWork& work = threadWork_[i];
+            std::string prefix = "thread_" + std::to_string(i) + "_";
+            summary[prefix + "pixels"] = static_cast<double>(work.pixels);
+            summary[prefix + "busy_time"] = work.busySeconds;
+            summary[prefix + "processing_rate"] = work.busySeconds > 0.0 ? work.pixels / work.busySeconds : 0.0;
+        }
+    }
+
+    return summary;
+}
+
+void CompressionStats::printReport() const {
+    auto summary = getSummary(true);
+    std::string line(60, '=');
+    std::string thinLine(60, '-');
+
+    std::cout << std::endl << line << std::endl;
+    std::cout << std::string(20, ' ') << "COMPRESSION REPORT" << std::endl;
+    std::cout << line << std::endl;
+    std::cout << std::fixed;
+    std::cout << "Total time:          " << formatTime(summary["elapsed_time"]) << std::endl;
+    std::cout << "Processing rate:     " << std::setprecision(0) << summary["processing_rate"] << " pixels/second" << std::endl;
+    std::cout << "Image dimensions:    " << width_ << "x" << height_ << " = " << totalPixels_ << " pixels" << std::endl;
+    std::cout << "Regions identified:  " << totalRegions_ << std::endl;
+    std::cout << "Compression ratio:   " << std::setprecision(2) << summary["compression_ratio"] << ":1" << std::endl;
+    std::cout << "Data size ratio:     " << summary["byte_ratio"] << ":1" << std::endl;
+    std::cout << thinLine << std::endl;
+    std::cout << "Original size:       " << formatBytes(bytesOriginal_) << std::endl;
+    std::cout << "Compressed size:     " << formatBytes(bytesCompressed_) << std::endl;
+    std::cout << "Space saved:         " << formatBytes(bytesOriginal_ - bytesCompressed_) << " ("
+              << std::setprecision(1) << (1.0 - 1.0 / summary["byte_ratio"]) * 100.0 << "%)" << std::endl;
+    std::cout << thinLine << std::endl;
+    std::cout << "Largest region:      " << largestRegion_ << " pixels" << std::endl;
+    std::cout << "Smallest region:     " << static_cast<int>(summary["smallest_region"]) << " pixels" << std::endl;
+    std::cout << "Average region size: " << std::setprecision(2) << avgRegionSize_ << " pixels" << std::endl;
+    if (regionSizeCap_ > 0) {
+        std::cout << "Region size cap:     " << regionSizeCap_ << " pixels (" << truncatedRegions_
+                  << " regions truncated)" << std::endl;
+    }
+    else {
+        std::cout << "Region size cap:     unlimited" << std::endl;
+    }
+    if (cacheHits_ + cacheMisses_ > 0) {
+        std::cout << thinLine << std::endl;
+        std::cout << "Cache lookups:       " << (cacheHits_ + cacheMisses_) << " ("
+                  << cacheHits_ << " hits, " << cacheMisses_ << " misses)" << std::endl;
+        std::cout << "Cache hit rate:      " << std::setprecision(1) << summary["cache_hit_rate"] * 100.0 << "%" << std::endl;
+    }
+    if (pyramidLevels_ > 0) {
+        std::cout << thinLine << std::endl;
+        std::cout << "Pyramid levels:      " << pyramidLevels_ << " (" << std::setprecision(1)
+                  << 100.0 * refinedPixels_ / std::max<int64_t>(1, totalPixels_)
+                  << "% of pixels regrown at full resolution)" << std::endl;
+    }
+    if (smallMerges_ > 0 || targetMerges_ > 0) {
+        std::cout << thinLine << std::endl;
+    }
+    if (smallMerges_ > 0) {
+        std::cout << "Merged regions:      " << smallMerges_ << " (smaller than the minimum region size)" << std::endl;
+    }
+    if (targetMerges_ > 0) {
+        std::cout << "Target merges:       " << targetMerges_ << " (closest-colored neighbors, toward the merge target)" << std::endl;
+    }
+    if (resultCacheState_ >= 0) {
+        std::cout << thinLine << std::endl;
+        std::cout << "Result cache:        " << (resultCacheState_ ? "hit" : "miss") << std::endl;
+    }
+    if (sequenceFrame_ >= 0) {
+        std::cout << thinLine << std::endl;
+        std::cout << "Sequence frame:      " << sequenceFrame_ << " (" << std::setprecision(1)
+                  << 100.0 * regrownPixels_ / std::max<int64_t>(1, totalPixels_)
+                  << "% of pixels regrown)" << std::endl;
+    }
+    if (!threadWork_.empty()) {
+        std::cout << thinLine << std::endl;
+        std::cout << "Worker threads:      " << threadWork_.size() << std::endl;
+        for (size_t i = 0; i < threadWork_.size(); ++i) {
+            const ThreadWork& work = threadWork_[i];
+            double rate = work.busySeconds > 0.0 ? work.pixels / work.busySeconds : 0.0;
+            std::cout << "  Thread " << std::setw(2) << i << ":         " << work.pixels << " pixels in "
+                      << std::setprecision(2) << work.busySeconds << " s ("
+                      << std::setprecision(0) << rate << " pixels/second)" << std::endl;
+        }
+    }
+    if (!metrics_.empty()) {
+        std::cout << thinLine << std::endl;
+        std::cout << "Phase timings:" << std::endl;
+        for (size_t i = 0; i < metrics::kPhaseCount; ++i) {
+            metrics::Phase phase = static_cast<metrics::Phase>(i);
+            if (metrics_.calls(phase) > 0) {
+                std::cout << "  " << std::left << std::setw(21) << metrics::phaseName(phase) << std::right
+                          << std::setprecision(3) << metrics_.seconds(phase) << " s ("
+                          << metrics_.calls(phase) << " calls)" << std::endl;
+            }
+        }
+        std::cout << "Counters:" << std::endl;
+        for (size_t i = 0; i < metrics::kCounterCount; ++i) {
+            metrics::Counter counter = static_cast<metrics::Counter>(i);
+            if (metrics_.count(counter) > 0) {
+                std::cout << "  " << std::left << std::setw(21) << metrics::counterName(counter) << std::right
+                          << metrics_.count(counter) << std::endl;
+            }
+        }
+    }
+    std::cout << line << std::endl;
+    std::cout.unsetf(std::ios_base::floatfield);
+}
+
+void CompressionStats::writeJson(std::ostream& out) const {
+    // Sorted keys keep the output stable between runs
+    auto summary = getSummary(true);
+    std::vector<std::pair<std::string, double>> entries(summary.begin(), summary.end());
+    std::sort(entries.begin(), entries.end());
+
+    std::streamsize precision = out.precision(15);
+    out << "{\"summary\": {";
+    for (size_t i = 0; i < entries.size(); ++i) {
+        out << (i == 0 ? "" : ", ") << "\"" << entries[i].first << "\": " << entries[i].second;
+    }
+    out << "}, \"metrics\": ";
+    metrics_.writeJson(out);
+    out << "}" << std::endl;
+    out.precision(precision);
+}
+
+std::string CompressionStats::formatBytes(int64_t bytes) const {
+    std::ostringstream oss;
+    if (bytes < 1024) {
+        oss << bytes << " bytes";
+    }
+    else if (bytes < 1024 * 1024) {
+        oss << std::fixed << std::setprecision(2) << bytes / 1024.0 << " KB";
+    }
+    else {
+        oss << std::fixed << std::setprecision(2) << bytes / (1024.0 * 1024.0) << " MB";
+    }
+    return oss.str();
+}
+
+std::string CompressionStats::formatTime(double seconds) const {
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(2);
+    if (seconds < 60) {
+        oss << seconds << " seconds";
+    }
+    else if (seconds < 3600) {
+        int minutes = static_cast<int>(seconds / 60);
+        oss << minutes << " minutes, " << (seconds - minutes * 60) << " seconds";
+    }
+    else {
+        int hours = static_cast<int>(seconds / 3600);
+        int minutes = static_cast<int>((seconds - hours * 3600) / 60);
+        oss << hours << " hours, " << minutes << " minutes, "
+            << (seconds - hours * 3600 - minutes * 60) << " seconds";
+    }
+    return oss.str();
+}
+
+// ---------------------------------------------------------------------------
+// ImageCompressor
+// ---------------------------------------------------------------------------
+
+int ImageCompressor::autoMaxRegionSize(int width, int height) {
+    int64_t pixels = static_cast<int64_t>(width) * height;
+    int64_t cap = std::max<int64_t>(kMinAutoRegionSize, pixels / 20);
+
+    // Growing one region keeps its pixel indices plus a frontier that holds
+    // up to a few entries per pixel
+    uint64_t available = availableMemoryBytes();
+    if (available > 0) {
+        uint64_t bytesPerPixel = sizeof(uint32_t) + 4 * sizeof(FrontierEntry);
+        cap = std::min<int64_t>(cap, static_cast<int64_t>(available / 4 / bytesPerPixel));
+    }
+    return static_cast<int>(std::max<int64_t>(1, std::min<int64_t>(cap, std::numeric_limits<int>::max())));
+}
+
+ImageCompressor::ImageCompressor(double similarityThreshold, int maxRegionSize,
+                               ProgressCallback progressCallback,
+                               Algorithm algorithm, bool adaptiveMode)
+    : similarityThreshold_(similarityThreshold), maxRegionSize_(maxRegionSize),
+      progressCallback_(progressCallback), algorithm_(algorithm), adaptiveMode_(adaptiveMode) {
+    if (similarityThreshold < 0.0 || similarityThreshold > 1.0) {
+        throw std::invalid_argument("Similarity threshold must be between 0.0 and 1.0");
+    }
+}
+
+std::shared_ptr<Image> ImageCompressor::decodeImage(const std::string& imagePath, int rawWidth, int rawHeight) {
+    if (!std::filesystem::exists(imagePath)) {
+        std::cerr << "Image file not found: " << imagePath << std::endl;
+        return nullptr;
+    }
+    try {
+        if (rawWidth > 0 && rawHeight > 0) {
+            return std::make_shared<Image>(Image::mapRaw(imagePath, rawWidth, rawHeight));
+        }
+        return std::make_shared<Image>(imagePath);
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return nullptr;
+    }
+}
+
+bool ImageCompressor::loadImage(const std::string& imagePath) {
+    // Count decoding as part of this job
+    metrics::Snapshot baseline = metrics::collect();
+    std::shared_ptr<Image> image = decodeImage(imagePath);
+    if (!image) {
+        image_ = nullptr;
+        localStats_ = nullptr;
+        return false;
+    }
+    setImage(std::move(image));
+    metricsBaseline_ = baseline;
+
+    std::cout << "Loaded image: " << imagePath << ", size: " << width_ << "x" << height_ << std::endl;
+    return true;
+}
+
+void ImageCompressor::setSequenceMode(bool enabled) {
+    sequenceMode_ = enabled;
+    sequenceFrame_ = 0;
+    previousFrame_ = nullptr;
+}
+
+void ImageCompressor::setImage(std::shared_ptr<Image> image) {
+    metricsBaseline_ = metrics::collect();
+
+    // In sequence mode the regions of the last frame are the starting point
+    bool keepRegions = sequenceMode_ && image_ && !regionColors_.empty() &&
+                       image->getWidth() == labels_.getWidth() && image->getHeight() == labels_.getHeight();
+    previousFrame_ = keepRegions ? image_ : nullptr;
+
+    image_ = std::move(image);
+    width_ = image_->getWidth();
+    height_ = image_->getHeight();
+    localStats_ = nullptr;
+    gradient_ = nullptr;
+    pyramid_.clear();
+    if (pyramidLevels_ > 0) {
+        buildPyramid();
+    }
+    if (!keepRegions) {
+        labels_ = LabelMap();
+        regionColors_.clear();
+        regionSums_.clear();
+    }
+}
+
+void ImageCompressor::buildPyramid() {
+    metrics::ScopedTimer timer(metrics::Phase::PYRAMID);
+    pyramid_.clear();
+    const Image* level = image_.get();
+    for (int i = 0; i < pyramidLevels_ && (level->getWidth() > 1 || level->getHeight() > 1); ++i) {
+        pyramid_.push_back(level->downsample());
+        level = &pyramid_.back();
+    }
+}
+
+std::unique_ptr<SeedScheduler> ImageCompressor::createSeedScheduler() {
+    if (seedOrder_ != SeedOrder::RASTER && !gradient_) {
+        gradient_ = std::make_shared<GradientMap>(*image_);
+    }
+    return ic::createSeedScheduler(seedOrder_, gradient_);
+}
+
+std::shared_ptr<const LocalStatistics> ImageCompressor::localStatistics() {
+    if (!localStats_) {
+        localStats_ = std::make_shared<LocalStatistics>(*image_);
+    }
+    return localStats_;
+}
+
+template <typename Grower>
+void ImageCompressor::compressSerial(Grower& regionFinder) {
+    // One region at a time goes through the buffer, so after the largest
+    // region it never allocates again
+    RegionBuffer buffer;
+    std::unique_ptr<SeedScheduler> seeds = createSeedScheduler();
+    seeds->reset(Rect(0, 0, width_, height_));
+
+    // Grow a region from every seed candidate not yet processed
+    int x = 0;
+    int y = 0;
+    while (seeds->next(x, y)) {
+        if (labels_.isAssigned(x, y)) {
+            continue;
+        }
+
+        buffer.clear();
+        RegionView region;
+        {
+            metrics::ScopedTimer timer(metrics::Phase::REGION_GROWTH);
+            region = regionFinder.appendRegion(x, y, labels_, buffer);
+        }
+        if (region.length == 0) {
+            continue;
+        }
+
+        // Assign the region id; the grower summed its colors on the way
+        uint32_t regionId = static_cast<uint32_t>(regionColors_.size());
+        uint32_t* labels = labels_.data();
+        for (uint32_t index : buffer.indices(region)) {
+            labels[index] = regionId;
+        }
+        regionColors_.push_back(regionFinder.getLastRegionStats().sums.mean());
+        truncatedRegions_ += regionFinder.lastRegionTruncated();
+        stats_.addRegion(static_cast<int>(region.length));
+        progress_.add(region.length);
+    }
+}
+
+bool ImageCompressor::compress() {
+    if (!image_) {
+        std::cerr << "No image loaded. Call loadImage() first." << std::endl;
+        return false;
+    }
+
+    // Reset regions and stats, unless this frame only updates the last one.
+    // Once most of the frame changed, a full compress is as cheap and keeps
+    // the raster seed order.
+    bool incremental = previousFrame_ && algorithm_ == Algorithm::ADAPTIVE && !backend_;
+    std::vector<Rect> zone;
+    if (incremental) {
+        zone = changedZone();
+        int64_t zoneArea = 0;
+        for (const Rect& rect : zone) {
+            zoneArea += static_cast<int64_t>(rect.area());
+        }
+        incremental = zoneArea * 4 < static_cast<int64_t>(width_) * height_ * 3;
+    }
+    if (!incremental) {
+        labels_.reset(width_, height_);
+        regionColors_.clear();
+    }
+    stats_ = CompressionStats();
+    stats_.start(width_, height_);
+    regionSizeCap_ = maxRegionSize_ == kAutoRegionSize ? autoMaxRegionSize(width_, height_)
+                                                       : std::max(0, maxRegionSize_);
+    truncatedRegions_ = 0;
+
+    // Workers only bump progress_; a reporter thread does the rest
+    progress_.reset(static_cast<int64_t>(width_) * height_);
+    std::unique_ptr<ProgressReporter> reporter;
+    if (ProgressSink sink = createProgressSink()) {
+        reporter = std::make_unique<ProgressReporter>(progress_, progressUpdateInterval_, std::move(sink));
+    }
+
+    // A cached result replaces segmentation and the merges that shaped it
+    bool cached = false;
+    ResultCache::Key cacheKey;
+    if (resultCache_ && !incremental) {
+        cacheKey = resultCacheKey();
+        cached = loadCachedResult(cacheKey);
+        stats_.setResultCacheHit(cached);
+    }
+
+    bool segmented = true;
+    if (cached) {
+        // labels_ and regionColors_ came from the cache
+    }
+    else if (backend_) {
+        segmented = compressWithBackend(*backend_);
+    }
+    else if (algorithm_ == Algorithm::MEAN_SHIFT) {
+        // Mode seeking runs on threadCount_ threads inside the segmenter;
+        // collecting regions from the mode map is cheap and stays serial
+        std::unique_ptr<MeanShiftSegmenter> segmenter = createSegmenter();
+        compressSerial(*segmenter);
+    }
+    else if (algorithm_ == Algorithm::UNION_FIND) {
+        UnionFindBackend unionFind;
+        segmented = compressWithBackend(unionFind);
+    }
+    else if (incremental) {
+        compressIncremental(zone);
+    }
+    else if (pyramidLevels_ > 0) {
+        compressPyramid();
+    }
+    else if (threadCount_ != 1 || tileSize_ > 0) {
+        compressTiled();
+    }
+    else {
+        std::unique_ptr<AdaptiveRegionGrower> grower = createGrower();
+        compressSerial(*grower);
+        const SimilarityCache& cache = grower->similarityCache();
+        stats_.setCacheStats(cache.hits(), cache.misses());
+    }
+    if (!segmented) {
+        if (reporter) {
+            reporter->stop();
+        }
+        return false;
+    }
+    
+    stats_.setRegionSizeCap(regionSizeCap_, truncatedRegions_);
+
+    // Unchanged regions of a sequence frame were merged when first grown
+    if ((minRegionSize_ > 1 || mergeTarget_.enabled()) && !incremental && !cached) {
+        mergeRegions();
+    }
+    if (resultCache_ && !incremental && !cached) {
+        resultCache_->store(cacheKey, RegionMap(labels_, regionColors_), entropyCoding_);
+    }
+
+    if (sequenceMode_) {
+        if (!incremental) {
+            rebuildRegionSums();
+            stats_.setSequenceStats(sequenceFrame_, static_cast<int64_t>(width_) * height_);
+        }
+        ++sequenceFrame_;
+        previousFrame_ = nullptr;
+    }
+
+    // Finalize statistics; stopping the reporter delivers the final sample
+    stats_.finish();
+    stats_.setMetrics(metrics::collect() - metricsBaseline_);
+    if (reporter) {
+        reporter->stop();
+    }
+
+    if (reportEnabled_) {
+        stats_.printReport();
+    }
+    return true;
+}
+
+std::unique_ptr<AdaptiveRegionGrower> ImageCompressor::createGrower() {
+    return createGrower(*image_, adaptiveMode_ ? localStatistics() : nullptr, regionSizeCap_);
+}
+
+std::unique_ptr<AdaptiveRegionGrower> ImageCompressor::createGrower(
+        const Image& image, std::shared_ptr<const LocalStatistics> localStats, int maxRegionSize) const {
+    auto grower = std::make_unique<AdaptiveRegionGrower>(
+        image, similarityThreshold_, maxRegionSize, adaptiveMode_, similarityCacheEntries_, std::move(localStats));
+    grower->setDistanceMode(distanceMode_);
+    grower->setConnectivity(connectivity_);
+    grower->setFrontierMode(frontierMode_);
+    grower->setAdaptiveRadius(adaptiveRadius_);
+    grower->setRunningMean(runningMean_);
+    return grower;
+}
+
+std::unique_ptr<MeanShiftSegmenter> ImageCompressor::createSegmenter() const {
+    // Color bandwidth from the threshold, as in the Python version
+    auto segmenter = std::make_unique<MeanShiftSegmenter>(
+        *image_, 1.0 - similarityThreshold_, MeanShiftSegmenter::kDefaultSpatialBandwidth, regionSizeCap_);
+    segmenter->setConnectivity(connectivity_);
+    segmenter->setThreadCount(threadCount_);
+    return segmenter;
+}
+
+namespace {
+
+// Regions found in one tile; labels inside the tile are tile-local ids
+struct TileResult {
+    std::vector<RegionSums> regions;
+    int64_t truncated = 0;
+    int worker = 0;
+    double seconds = 0.0;
+};
+
+// Merges touching regions whose (running) average colors pass the
+// similarity threshold, as long as the result stays within the size cap
+class RegionStitcher {
+public:
+    RegionStitcher(std::vector<RegionSums>& regions, double similarityThreshold, int maxRegionSize)
+        : regions_(regions), sets_(regions.size()), similarityThreshold_(similarityThreshold),
+          maxRegionSize_(maxRegionSize) {}
+
+    void tryMerge(uint32_t a, uint32_t b) {
+        uint32_t rootA = sets_.find(a);
+        uint32_t rootB = sets_.find(b);
+        if (rootA == rootB) {
+            return;
+        }
+        uint64_t combined = static_cast<uint64_t>(regions_[rootA].count) + regions_[rootB].count;
+        if (maxRegionSize_ > 0 && combined > static_cast<uint64_t>(maxRegionSize_)) {
+            return;
+        }
+        if (colorSimilarity(regions_[rootA].mean(), regions_[rootB].mean()) < similarityThreshold_) {
+            return;
+        }
+        uint32_t root = sets_.unite(rootA, rootB);
+        regions_[root].merge(regions_[root == rootA ? rootB : rootA]);
+    }
+
+    // Give the surviving non-empty roots dense ids, appending their colors
+    // and sizes; returns the new id of every old id
+    std::vector<uint32_t> compact(std::vector<Color>& colors, std::vector<int>& sizes) {
+        std::vector<uint32_t> finalId(regions_.size(), LabelMap::kUnassigned);
+        for (uint32_t id = 0; id < regions_.size(); ++id) {
+            uint32_t root = sets_.find(id);
+            if (regions_[root].count == 0) {
+                continue;
+            }
+            if (finalId[root] == LabelMap::kUnassigned) {
+                finalId[root] = static_cast<uint32_t>(colors.size());
+                colors.push_back(regions_[root].mean());
+                sizes.push_back(static_cast<int>(regions_[root].count));
+            }
+            finalId[id] = finalId[root];
+        }
+        return finalId;
+    }
+
+private:
+    std::vector<RegionSums>& regions_;
+    DisjointSet sets_;
+    double similarityThreshold_;
+    int maxRegionSize_;
+};
+
+} // namespace
+
+void ImageCompressor::compressTiled() {
+    int tileSize = tileSize_ > 0 ? tileSize_ : kDefaultTileSize;
+    ThreadPool pool(threadCount_);
+
+    // One grower, seed scheduler and region buffer per worker: growers keep
+    // per-call scratch state, and all are reused for every tile the worker
+    // takes. Schedulers are created here so the gradient map is built once.
+    std::vector<std::unique_ptr<AdaptiveRegionGrower>> growers;
+    std::vector<std::unique_ptr<SeedScheduler>> schedulers;
+    for (int i = 0; i < pool.size(); ++i) {
+        growers.push_back(createGrower());
+        schedulers.push_back(createSeedScheduler());
+    }
+    std::vector<RegionBuffer> buffers(pool.size());
+
+    std::vector<Rect> tiles;
+    for (int ty = 0; ty < height_; ty += tileSize) {
+        for (int tx = 0; tx < width_; tx += tileSize) {
+            tiles.emplace_back(tx, ty, std::min(tileSize, width_ - tx), std::min(tileSize, height_ - ty));
+        }
+    }
+
+    // Grow regions inside each tile. Tiles own disjoint pixels of labels_,
+    // and growers never leave their bounds, so no locking is needed.
+    std::vector<std::future<TileResult>> pending;
+    pending.reserve(tiles.size());
+    for (const Rect& tile : tiles) {
+        pending.push_back(pool.submit([this, &growers, &schedulers, &buffers, tile]() {
+            auto begin = std::chrono::high_resolution_clock::now();
+            metrics::ScopedTimer timer(metrics::Phase::REGION_GROWTH);
+            TileResult result;
+            result.worker = ThreadPool::currentWorkerIndex();
+
+            AdaptiveRegionGrower& grower = *growers[result.worker];
+            RegionBuffer& buffer = buffers[result.worker];
+            SeedScheduler& seeds = *schedulers[result.worker];
+            grower.setBounds(tile);
+            seeds.reset(tile);
+
+            int x = 0;
+            int y = 0;
+            while (seeds.next(x, y)) {
+                if (labels_.isAssigned(x, y)) {
+                    continue;
+                }
+
+                uint32_t localId = static_cast<uint32_t>(result.regions.size());
+                buffer.clear();
+                RegionView region = grower.appendRegion(x, y, labels_, buffer);
+                uint32_t* labels = labels_.data();
+                for (uint32_t index : buffer.indices(region)) {
+                    labels[index] = localId;
+                }
+                const RegionSums& sums = grower.getLastRegionStats().sums;
+                result.regions.push_back(sums);
+                result.truncated += grower.lastRegionTruncated();
+                progress_.add(sums.count);
+            }
+
+            result.seconds = std::chrono::duration<double>(
+                std::chrono::high_resolution_clock::now() - begin).count();
+            return result;
+        }));
+    }
+
+    // Collect tiles in order and give each tile a base for global ids
+    std::vector<RegionSums> regions;
+    std::vector<uint32_t> tileBase(tiles.size());
+    for (size_t i = 0; i < tiles.size(); ++i) {
+        TileResult result = pending[i].get();
+        tileBase[i] = static_cast<uint32_t>(regions.size());
+        for (const auto& sums : result.regions) {
+            stats_.addRegion(static_cast<int>(sums.count));
+        }
+        regions.insert(regions.end(), result.regions.begin(), result.regions.end());
+        truncatedRegions_ += result.truncated;
+        stats_.addThreadWork(result.worker, static_cast<int64_t>(tiles[i].area()), result.seconds);
+    }
+
+    std::vector<std::future<void>> relabels;
+    for (size_t i = 0; i < tiles.size(); ++i) {
+        if (tileBase[i] == 0) {
+            continue;
+        }
+        relabels.push_back(pool.submit([this, &tiles, &tileBase, i]() {
+            const Rect& tile = tiles[i];
+            for (int y = tile.y; y < tile.y + tile.height; ++y) {
+                uint32_t* row = labels_.data() + labels_.index(tile.x, y);
+                for (int x = 0; x < tile.width; ++x) {
+                    row[x] += tileBase[i];
+                }
+            }
+        }));
+    }
+    for (auto& relabel : relabels) {
+        relabel.get();
+    }
+
+    // Stitch: merge regions that touch across a tile edge when their
+    // (running) average colors pass the similarity threshold
+    auto stitchStart = std::chrono::steady_clock::now();
+    RegionStitcher stitcher(regions, similarityThreshold_, regionSizeCap_);
+    for (int x = tileSize; x < width_; x += tileSize) {
+        for (int y = 0; y < height_; ++y) {
+            stitcher.tryMerge(labels_.get(x - 1, y), labels_.get(x, y));
+        }
+    }
+    for (int y = tileSize; y < height_; y += tileSize) {
+        for (int x = 0; x < width_; ++x) {
+            stitcher.tryMerge(labels_.get(x, y - 1), labels_.get(x, y));
+        }
+    }
+    metrics::addTime(metrics::Phase::STITCHING, std::chrono::steady_clock::now() - stitchStart);
+
+    // Compact the surviving roots into dense ids
+    std::vector<int> regionSizes;
+    std::vector<uint32_t> finalId = stitcher.compact(regionColors_, regionSizes);
+
+    std::vector<std::future<void>> remaps;
+    for (const Rect& tile : tiles) {
+        remaps.push_back(pool.submit([this, &finalId, tile]() {
+            for (int y = tile.y; y < tile.y + tile.height; ++y) {
+                uint32_t* row = labels_.data() + labels_.index(tile.x, y);
+                for (int x = 0; x < tile.width; ++x) {
+                    row[x] = finalId[row[x]];
+                }
+            }
+        }));
+    }
+    for (auto& remap : remaps) {
+        remap.get();
+    }
+
+    stats_.setRegionSizes(std::move(regionSizes));
+
+    uint64_t hits = 0, misses = 0;
+    for (const auto& grower : growers) {
+        hits += grower->similarityCache().hits();
+        misses += grower->similarityCache().misses();
+    }
+    stats_.setCacheStats(hits, misses);
+}
+
+void ImageCompressor::mergeRegions() {
+    metrics::ScopedTimer timer(metrics::Phase::MERGING);
+    RegionGraph graph(labels_, *image_, regionColors_.size());
+    int smallMerges = 0;
+    int targetMerges = 0;
+    if (minRegionSize_ > 1) {
+        smallMerges = mergeSmallRegions(graph, static_cast<uint32_t>(minRegionSize_), regionSizeCap_);
+    }
+    if (mergeTarget_.enabled()) {
+        targetMerges = mergeToTarget(graph, mergeTarget_, regionSizeCap_);
+    }
+
+    regionColors_.clear();
+    std::vector<int> regionSizes;
+    std::vector<uint32_t> finalId = graph.compact(regionColors_, regionSizes);
+    uint32_t* labels = labels_.data();
+    for (size_t i = 0; i < labels_.size(); ++i) {
+        labels[i] = finalId[labels[i]];
+    }
+    stats_.setRegionSizes(std::move(regionSizes));
+    stats_.setMergedRegions(smallMerges, targetMerges);
+}
+
+ResultCache::Key ImageCompressor::resultCacheKey() const {
+    // Bump when a change alters the output for the same options
+    constexpr int kResultVersion = 1;
+    bool tiled = algorithm_ == Algorithm::ADAPTIVE && pyramidLevels_ == 0 && (threadCount_ != 1 || tileSize_ > 0);
+
+    // The requested cap, not the resolved one: under -m auto that follows
+    // free memory, and the same request should find the same entry
+    std::ostringstream parameters;
+    parameters << std::setprecision(17) << kResultVersion << ' ' << algorithmName(algorithm_) << ' '
+               << similarityThreshold_ << ' ' << adaptiveMode_ << ' ' << maxRegionSize_ << ' '
+               << static_cast<int>(distanceMode_) << ' ' << static_cast<int>(connectivity_) << ' '
+               << static_cast<int>(frontierMode_) << ' ' << runningMean_ << ' ' << adaptiveRadius_ << ' '
+               << static_cast<int>(seedOrder_) << ' ' << minRegionSize_ << ' ' << mergeTarget_.regionCount << ' '
+               << mergeTarget_.maxColorDelta << ' ' << pyramidLevels_ << ' '
+               << (tiled ? (tileSize_ > 0 ? tileSize_ : kDefaultTileSize) : 0) << ' '
+               << (backend_ ? backend_->name() : "");
+    std::string text = parameters.str();
+
+    ResultCache::Key key;
+    key.content = ResultCache::hashImage(*image_);
+    key.parameters = hashBytes(text.data(), text.size());
+    return key;
+}
+
+bool ImageCompressor::loadCachedResult(const ResultCache::Key& key) {
+    RegionMap cachedMap;
+    if (!resultCache_->load(key, cachedMap) || cachedMap.getWidth() != width_ || cachedMap.getHeight() != height_) {
+        return false;
+    }
+    labels_ = cachedMap.getLabels();
+    regionColors_ = cachedMap.getPalette();
+
+    std::vector<int> regionSizes(regionColors_.size(), 0);
+    const uint32_t* labels = labels_.data();
+    for (size_t i = 0; i < labels_.size(); ++i) {
+        ++regionSizes[labels[i]];
+    }
+    for (int size : regionSizes) {
+        stats_.addRegion(size);
+    }
+    progress_.add(static_cast<int64_t>(width_) * height_, static_cast<int64_t>(regionSizes.size()));
+    return true;
+}
+
+bool ImageCompressor::compressWithBackend(SegmentationBackend& backend) {
+    SegmentationRequest request;
+    request.image = image_.get();
+    request.localStats = adaptiveMode_ && backend.usesLocalStatistics() ? localStatistics() : nullptr;
+    request.similarityThreshold = similarityThreshold_;
+    request.maxRegionSize = regionSizeCap_;
+    request.adaptiveMode = adaptiveMode_;
+    request.runningMean = runningMean_;
+    request.connectivity = connectivity_;
+    request.distanceMode = distanceMode_;
+    request.threadCount = threadCount_;
+    request.progress = &progress_;
+
+    std::vector<int> regionSizes;
+    bool segmented = false;
+    {
+        metrics::ScopedTimer timer(metrics::Phase::REGION_GROWTH);
+        segmented = backend.segment(request, labels_, regionColors_, regionSizes);
+    }
+
+    // Everything after this indexes regionColors_ with the labels unchecked
+    if (segmented) {
+        size_t regionCount = regionColors_.size();
+        const uint32_t* labels = labels_.data();
+        segmented = regionSizes.size() == regionCount &&
+                    labels_.getWidth() == width_ && labels_.getHeight() == height_ &&
+                    std::all_of(labels, labels + labels_.size(),
+                                [regionCount](uint32_t id) { return id < regionCount; });
+    }
+    if (!segmented) {
+        std::cerr << "Segmentation backend '" << backend.name() << "' failed" << std::endl;
+        regionColors_.clear();
+        return false;
+    }
+
+    for (int size : regionSizes) {
+        stats_.addRegion(size);
+    }
+    return true;
+}
+
+void ImageCompressor::compressPyramid() {
+    // Levels may have been set after the image; tiny images stop early
+    if (static_cast<int>(pyramid_.size()) != pyramidLevels_) {
+        buildPyramid();
+    }
+    const Image& coarse = pyramid_.back();
+    int levels = static_cast<int>(pyramid_.size());
+    int scale = 1 << levels;
+    int coarseWidth = coarse.getWidth();
+    int coarseHeight = coarse.getHeight();
+    uint64_t hits = 0, misses = 0;
+
+    // Segment the coarsest level, with the size cap scaled to its pixels
+    LabelMap coarseLabels(coarseWidth, coarseHeight);
+    uint32_t coarseCount = 0;
+    {
+        metrics::ScopedTimer timer(metrics::Phase::REGION_GROWTH);
+        int coarseMaxSize = regionSizeCap_ > 0 ? std::max(1, regionSizeCap_ / (scale * scale)) : 0;
+        std::unique_ptr<AdaptiveRegionGrower> grower = createGrower(coarse, nullptr, coarseMaxSize);
+        RegionBuffer buffer;
+        for (int y = 0; y < coarseHeight; ++y) {
+            for (int x = 0; x < coarseWidth; ++x) {
+                if (coarseLabels.isAssigned(x, y)) {
+                    continue;
+                }
+                buffer.clear();
+                RegionView region = grower->appendRegion(x, y, coarseLabels, buffer);
+                for (uint32_t index : buffer.indices(region)) {
+                    coarseLabels.data()[index] = coarseCount;
+                }
+                ++coarseCount;
+            }
+        }
+        hits += grower->similarityCache().hits();
+        misses += grower->similarityCache().misses();
+    }
+
+    // A block is detailed when its RMS deviation from its own mean, from
+    // the same normalized variance the adaptive threshold uses, exceeds half
+    // the color distance the threshold accepts
+    double acceptDistance = (1.0 - similarityThreshold_) * 441.67;
+    double detailVariance = (0.25 * acceptDistance * acceptDistance) / (3.0 * 255.0 * 255.0);
+    std::shared_ptr<const LocalStatistics> localStats = localStatistics();
+
+    // Project every coarse cell that is away from a region boundary and not
+    // detailed; the cells left over are regrown at full resolution
+    std::vector<RegionSums> regions(coarseCount);
+    uint32_t* labels = labels_.data();
+    int64_t projected = 0;
+    for (int cy = 0; cy < coarseHeight; ++cy) {
+        for (int cx = 0; cx < coarseWidth; ++cx) {
+            uint32_t id = coarseLabels.get(cx, cy);
+            bool boundary = false;
+            for (const auto& offset : RegionGrower::kNeighborOffsets) {
+                int nx = cx + offset[0];
+                int ny = cy + offset[1];
+                if (nx >= 0 && ny >= 0 && nx < coarseWidth && ny < coarseHeight &&
+                    coarseLabels.get(nx, ny) != id) {
+                    boundary = true;
+                    break;
+                }
+            }
+            if (boundary) {
+                continue;
+            }
+
+            int x0 = cx * scale;
+            int y0 = cy * scale;
+            int x1 = std::min(x0 + scale, width_);
+            int y1 = std::min(y0 + scale, height_);
+            if (localStats->normalizedVariance((x0 + x1) / 2, (y0 + y1) / 2, scale / 2) > detailVariance) {
+                continue;
+            }
+            for (int y = y0; y < y1; ++y) {
+                for (int x = x0; x < x1; ++x) {
+                    labels[labels_.index(x, y)] = id;
+                    regions[id].add(image_->at(x, y));
+                }
+            }
+            projected += static_cast<int64_t>(x1 - x0) * (y1 - y0);
+        }
+    }
+    progress_.add(projected, 0);
+
+    // Regrow what wasn't projected; these regions get ids after the coarse ones
+    {
+        metrics::ScopedTimer timer(metrics::Phase::REGION_GROWTH);
+        std::unique_ptr<AdaptiveRegionGrower> grower = createGrower();
+        RegionBuffer buffer;
+        for (int y = 0; y < height_; ++y) {
+            for (int x = 0; x < width_; ++x) {
+                if (labels_.isAssigned(x, y)) {
+                    continue;
+                }
+                buffer.clear();
+                RegionView region = grower->appendRegion(x, y, labels_, buffer);
+                uint32_t id = static_cast<uint32_t>(regions.size());
+                for (uint32_t index : buffer.indices(region)) {
+                    labels[index] = id;
+                }
+                regions.push_back(grower->getLastRegionStats().sums);
+                truncatedRegions_ += grower->lastRegionTruncated();
+                progress_.add(region.length);
+            }
+        }
+        hits += grower->similarityCache().hits();
+        misses += grower->similarityCache().misses();
+    }
+
+    // Stitch regrown regions to each other and to the projected ones
+    auto stitchStart = std::chrono::steady_clock::now();
+    RegionStitcher stitcher(regions, similarityThreshold_, regionSizeCap_);
+    for (int y = 0; y < height_; ++y) {
+        for (int x = 0; x < width_; ++x) {
+            uint32_t id = labels[labels_.index(x, y)];
+            if (x + 1 < width_) {
+                uint32_t right = labels[labels_.index(x + 1, y)];
+                if (right != id && std::max(id, right) >= coarseCount) {
+                    stitcher.tryMerge(id, right);
+                }
+            }
+            if (y + 1 < height_) {
+                uint32_t below = labels[labels_.index(x, y + 1)];
+                if (below != id && std::max(id, below) >= coarseCount) {
+                    stitcher.tryMerge(id, below);
+                }
+            }
+        }
+    }
+
+    std::vector<int> regionSizes;
+    std::vector<uint32_t> finalId = stitcher.compact(regionColors_, regionSizes);
+    for (size_t i = 0; i < labels_.size(); ++i) {
+        labels[i] = finalId[labels[i]];
+    }
+    metrics::addTime(metrics::Phase::STITCHING, std::chrono::steady_clock::now() - stitchStart);
+
+    stats_.setRegionSizes(std::move(regionSizes));
+    stats_.setCacheStats(hits, misses);
+    stats_.setPyramidStats(levels, static_cast<int64_t>(width_) * height_ - projected);
+}
+
+void ImageCompressor::rebuildRegionSums() {
+    regionSums_.assign(regionColors_.size(), RegionSums());
+    const uint32_t* labels = labels_.data();
+    const Color* pixels = image_->data();
+    for (size_t i = 0; i < labels_.size(); ++i) {
+        regionSums_[labels[i]].add(pixels[i]);
+    }
+}
+
+void ImageCompressor::compactRegions() {
+    std::vector<uint32_t> newId(regionSums_.size(), LabelMap::kUnassigned);
+    std::vector<RegionSums> sums;
+    std::vector<Color> colors;
+    for (uint32_t id = 0; id < regionSums_.size(); ++id) {
+        if (regionSums_[id].count > 0) {
+            newId[id] = static_cast<uint32_t>(sums.size());
+            sums.push_back(regionSums_[id]);
+            colors.push_back(regionColors_[id]);
+        }
+    }
+    uint32_t* labels = labels_.data();
+    for (size_t i = 0; i < labels_.size(); ++i) {
+        labels[i] = newId[labels[i]];
+    }
+    regionSums_ = std::move(sums);
+    regionColors_ = std::move(colors);
+}
+
+std::vector<Rect> ImageCompressor::changedZone() const {
+    const int block = kSequenceBlockSize;
+    int blocksX = (width_ + block - 1) / block;
+    int blocksY = (height_ + block - 1) / block;
+    const Image& previous = *previousFrame_;
+
+    // Blocks with any changed pixel, row segment by row segment
+    std::vector<uint8_t> dirty(static_cast<size_t>(blocksX) * blocksY, 0);
+    for (int y = 0; y < height_; ++y) {
+        const Color* current = image_->row(y).data();
+        const Color* before = previous.row(y).data();
+        uint8_t* blockRow = dirty.data() + static_cast<size_t>(y / block) * blocksX;
+        for (int bx = 0; bx < blocksX; ++bx) {
+            int x0 = bx * block;
+            int length = std::min(block, width_ - x0);
+            if (!blockRow[bx] && std::memcmp(current + x0, before + x0, length * sizeof(Color)) != 0) {
+                blockRow[bx] = 1;
+            }
+        }
+    }
+
+    // Regrow the dirty blocks plus a one-block border, so new content can
+    // settle against fresh pixels on every side
+    std::vector<Rect> zone;
+    for (int by = 0; by < blocksY; ++by) {
+        for (int bx = 0; bx < blocksX; ++bx) {
+            bool near = false;
+            for (int dy = -1; dy <= 1 && !near; ++dy) {
+                for (int dx = -1; dx <= 1 && !near; ++dx) {
+                    int nx = bx + dx;
+                    int ny = by + dy;
+                    near = nx >= 0 && ny >= 0 && nx < blocksX && ny < blocksY &&
+                           dirty[static_cast<size_t>(ny) * blocksX + nx];
+                }
+            }
+            if (near) {
+                zone.emplace_back(bx * block, by * block, std::min(block, width_ - bx * block),
+                                  std::min(block, height_ - by * block));
+            }
+        }
+    }
+    return zone;
+}
+
+void ImageCompressor::compressIncremental(const std::vector<Rect>& zone) {
+    const Image& previous = *previousFrame_;
+
+    // Take the zone's pixels out of the regions they belonged to; regions
+    // keep their ids and whatever pixels they have left
+    uint32_t* labels = labels_.data();
+    uint32_t oldCount = static_cast<uint32_t>(regionSums_.size());
+    std::vector<uint32_t> touched;
+    int64_t regrown = 0;
+    for (const Rect& rect : zone) {
+        for (int y = rect.y; y < rect.y + rect.height; ++y) {
+            for (int x = rect.x; x < rect.x + rect.width; ++x) {
+                size_t index = labels_.index(x, y);
+                regionSums_[labels[index]].remove(previous.at(x, y));
+                if (touched.empty() || touched.back() != labels[index]) {
+                    touched.push_back(labels[index]);
+                }
+                labels[index] = LabelMap::kUnassigned;
+            }
+        }
+        regrown += static_cast<int64_t>(rect.area());
+    }
+    progress_.add(static_cast<int64_t>(width_) * height_ - regrown, 0);
+
+    // Grow new regions inside the zone; they can't claim kept pixels
+    {
+        metrics::ScopedTimer timer(metrics::Phase::REGION_GROWTH);
+        std::unique_ptr<AdaptiveRegionGrower> grower = createGrower();
+        RegionBuffer buffer;
+        for (const Rect& rect : zone) {
+            for (int y = rect.y; y < rect.y + rect.height; ++y) {
+                for (int x = rect.x; x < rect.x + rect.width; ++x) {
+                    if (labels_.isAssigned(x, y)) {
+                        continue;
+                    }
+                    buffer.clear();
+                    RegionView region = grower->appendRegion(x, y, labels_, buffer);
+                    uint32_t id = static_cast<uint32_t>(regionSums_.size());
+                    for (uint32_t index : buffer.indices(region)) {
+                        labels[index] = id;
+                    }
+                    regionSums_.push_back(grower->getLastRegionStats().sums);
+                    truncatedRegions_ += grower->lastRegionTruncated();
+                    progress_.add(region.length);
+                }
+            }
+        }
+        stats_.setCacheStats(grower->similarityCache().hits(), grower->similarityCache().misses());
+    }
+
+    // Stitch new regions onto the kept ones around them. New regions were
+    // grown across the whole zone, so they are never merged with each other,
+    // and two kept regions are never merged, so pixels outside the zone keep
+    // their ids and only the zone needs relabeling.
+    auto stitchStart = std::chrono::steady_clock::now();
+    uint32_t newCount = static_cast<uint32_t>(regionSums_.size()) - oldCount;
+    std::vector<uint32_t> attachedTo(newCount, LabelMap::kUnassigned);
+    auto resolve = [&](uint32_t id) {
+        return id >= oldCount && attachedTo[id - oldCount] != LabelMap::kUnassigned ? attachedTo[id - oldCount] : id;
+    };
+    auto tryMerge = [&](uint32_t a, uint32_t b) {
+        a = resolve(a);
+        b = resolve(b);
+        if ((a < oldCount) == (b < oldCount)) {
+            return;
+        }
+        // a is the kept region, b the new one it absorbs
+        if (b < oldCount) {
+            std::swap(a, b);
+        }
+        uint64_t combined = static_cast<uint64_t>(regionSums_[a].count) + regionSums_[b].count;
+        if (regionSizeCap_ > 0 && combined > static_cast<uint64_t>(regionSizeCap_)) {
+            return;
+        }
+        if (colorSimilarity(regionSums_[a].mean(), regionSums_[b].mean()) < similarityThreshold_) {
+            return;
+        }
+        attachedTo[b - oldCount] = a;
+        regionSums_[a].merge(regionSums_[b]);
+        regionSums_[b] = RegionSums();
+    };
+    for (const Rect& rect : zone) {
+        for (int y = rect.y; y < rect.y + rect.height; ++y) {
+            for (int x = rect.x; x < rect.x + rect.width; ++x) {
+                uint32_t id = labels[labels_.index(x, y)];
+                for (int i = 0; i < 4; ++i) {
+                    int nx = x + RegionGrower::kNeighborOffsets[i][0];
+                    int ny = y + RegionGrower::kNeighborOffsets[i][1];
+                    if (nx >= 0 && ny >= 0 && nx < width_ && ny < height_) {
+                        uint32_t other = labels[labels_.index(nx, ny)];
+                        if (other != id) {
+                            tryMerge(id, other);
+                        }
+                    }
+                }
+            }
+        }
+    }
+    for (const Rect& rect : zone) {
+        for (int y = rect.y; y < rect.y + rect.height; ++y) {
+            uint32_t* row = labels + labels_.index(rect.x, y);
+            for (int x = 0; x < rect.width; ++x) {
+                row[x] = resolve(row[x]);
+            }
+        }
+    }
+    metrics::addTime(metrics::Phase::STITCHING, std::chrono::steady_clock::now() - stitchStart);
+
+    // Refresh the colors of every region that lost or gained pixels
+    regionColors_.resize(regionSums_.size());
+    for (uint32_t id = oldCount; id < regionSums_.size(); ++id) {
+        touched.push_back(id);
+    }
+    std::sort(touched.begin(), touched.end());
+    touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+    for (uint32_t id : touched) {
+        if (regionSums_[id].count > 0) {
+            regionColors_[id] = regionSums_[id].mean();
+        }
+    }
+
+    // Dead ids cost nothing per frame, but compact once they pile up
+    size_t live = 0;
+    for (const auto& sums : regionSums_) {
+        if (sums.count > 0) {
+            ++live;
+            stats_.addRegion(static_cast<int>(sums.count));
+        }
+    }
+    if ((regionSums_.size() - live) * 4 > regionSums_.size()) {
+        compactRegions();
+    }
+    stats_.setSequenceStats(sequenceFrame_, regrown);
+}
+
+namespace {
+
+// Fill each region with its average color
+Image renderRegions(const Image& image, const LabelMap& labelMap, const std::vector<Color>& regionColors) {
+    metrics::ScopedTimer timer(metrics::Phase::ENCODE);
+    Image result = image.createSimilar();
+    for (int y = 0; y < image.getHeight(); ++y) {
+        Span<Color> row = result.row(y);
+        const uint32_t* labels = labelMap.data() + labelMap.index(0, y);
+        for (int x = 0; x < image.getWidth(); ++x) {
+            row[x] = regionColors[labels[x]];
+        }
+    }
+    return result;
+}
+
+// Write the output file and the metadata report next to it
+bool writeResult(const std::string& outputPath, const Image& image, const LabelMap& labels,
+                 const std::vector<Color>& regionColors, const CompressionStats& stats,
+                 const ImageCompressor::OutputSettings& settings) {
+    // .icr keeps the regions themselves; anything else is rendered to pixels
+    bool saved = RegionMap::isRegionMapPath(outputPath)
+               ? RegionMap(labels, regionColors).save(outputPath, settings.entropyCoding)
+               : renderRegions(image, labels, regionColors).save(outputPath);
+    if (!saved) {
+        return false;
+    }
+
+    int width = image.getWidth();
+    int height = image.getHeight();
+    double fileSizeKB = std::filesystem::file_size(outputPath) / 1024.0;
+
+    // Write a metadata report next to the output file
+    std::time_t now = std::time(nullptr);
+    char timestamp[32];
+    std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", std::localtime(&now));
+
+    std::filesystem::path metadataPath(outputPath);
+    metadataPath.replace_extension();
+    metadataPath += "_info.txt";
+
+    std::ofstream info(metadataPath);
+    if (info) {
+        int64_t totalPixels = static_cast<int64_t>(width) * height;
+        info << "Image Compression Report\n";
+        info << "======================\n\n";
+        info << "Timestamp: " << timestamp << "\n";
+        info << "Algorithm: " << algorithmName(settings.algorithm) << "\n";
+        info << "Similarity threshold: " << std::defaultfloat << settings.similarityThreshold << "\n";
+        info << "Adaptive mode: " << (settings.adaptiveMode ? "True" : "False") << "\n\n";
+        info << "Original dimensions: " << width << "x" << height << " = " << totalPixels << " pixels\n";
+        info << "Regions identified: " << regionColors.size() << "\n";
+        info << std::fixed << std::setprecision(2);
+        info << "Compression ratio: " << static_cast<double>(totalPixels) / regionColors.size() << ":1\n\n";
+        info << "Processing time: " << stats.getElapsedTime() << " seconds\n";
+        info << std::setprecision(0);
+        info << "Processing rate: " << stats.getProcessingRate() << " pixels/second\n\n";
+        info << std::setprecision(2);
+        info << "Output file size: " << fileSizeKB << " KB\n";
+    }
+
+    return true;
+}
+
+} // namespace
+
+bool ImageCompressor::saveCompressedImage(const std::string& outputPath) {
+    if (!image_ || regionColors_.empty()) {
+        std::cerr << "No compression data available. Call compress() first." << std::endl;
+        return false;
+    }
+
+    if (!writeResult(outputPath, *image_, labels_, regionColors_, stats_, outputSettings())) {
+        return false;
+    }
+    stats_.setMetrics(metrics::collect() - metricsBaseline_);
+
+    double fileSizeKB = std::filesystem::file_size(outputPath) / 1024.0;
+    std::cout << "File size: " << std::fixed << std::setprecision(2) << fileSizeKB << " KB" << std::endl;
+    return true;
+}
+
+ImageCompressor::OutputSettings ImageCompressor::outputSettings() const {
+    return OutputSettings{algorithm_, similarityThreshold_, adaptiveMode_, entropyCoding_};
+}
+
+bool ImageCompressor::copyResult(Result& result) const {
+    if (!image_ || regionColors_.empty()) {
+        std::cerr << "No compression data available. Call compress() first." << std::endl;
+        return false;
+    }
+    result = Result{image_, labels_, regionColors_, stats_, outputSettings()};
+    return true;
+}
+
+bool ImageCompressor::saveResult(const Result& result, const std::string& outputPath) {
+    try {
+        return writeResult(outputPath, *result.image, result.labels, result.regionColors, result.stats,
+                           result.settings);
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return false;
+    }
+}
+
+Image ImageCompressor::renderCompressedImage() const {
+    return renderRegions(*image_, labels_, regionColors_);
+}
+
+bool ImageCompressor::encodeCompressedImage(const std::string& extension, std::vector<uint8_t>& out) const {
+    if (!image_ || regionColors_.empty()) {
+        std::cerr << "No compression data available. Call compress() first." << std::endl;
+        return false;
+    }
+    if (extension.substr(extension.find_last_of('.') + 1) == "icr") {
+        out = RegionMap(labels_, regionColors_).encode(entropyCoding_);
+        return true;
+    }
+    return renderCompressedImage().encode(extension, out);
+}
+
+ThreadPool& ImageCompressor::stageThread(std::unique_ptr<ThreadPool>& stage) {
+    if (!stage) {
+        stage = std::make_unique<ThreadPool>(1);
+    }
+    return *stage;
+}
+
+std::future<std::shared_ptr<Image>> ImageCompressor::decodeAsync(const std::string& imagePath, DecodeCallback done,
+                                                                 int rawWidth, int rawHeight) {
+    return stageThread(decodeStage_).submit([imagePath, done, rawWidth, rawHeight]() {
+        std::shared_ptr<Image> image = decodeImage(imagePath, rawWidth, rawHeight);
+        if (done) {
+            done(image);
+        }
+        return image;
+    });
+}
+
+std::future<bool> ImageCompressor::segmentAsync(std::shared_ptr<Image> image, StageCallback done) {
+    return stageThread(segmentStage_).submit([this, image = std::move(image), done]() mutable {
+        bool ok = false;
+        if (image) {
+            setImage(std::move(image));
+            ok = compress();
+        }
+        else {
+            std::cerr << "No image to segment" << std::endl;
+        }
+        if (done) {
+            done(ok);
+        }
+        return ok;
+    });
+}
+
+std::future<bool> ImageCompressor::encodeAsync(const std::string& outputPath, StageCallback done) {
+    auto promise = std::make_shared<std::promise<bool>>();
+    std::future<bool> result = promise->get_future();
+    auto finish = [promise, done](bool ok) {
+        if (done) {
+            done(ok);
+        }
+        promise->set_value(ok);
+    };
+
+    // Both threads exist before any job runs, so a job never creates one
+    ThreadPool& encoder = stageThread(encodeStage_);
+    stageThread(segmentStage_).submit([this, outputPath, finish, &encoder]() {
+        auto job = std::make_shared<Result>();
+        if (!copyResult(*job)) {
+            finish(false);
+            return;
+        }
+        encoder.submit([outputPath, finish, job]() {
+            finish(saveResult(*job, outputPath));
+        });
+    });
+    return result;
+}
+
+ProgressSink ImageCompressor::createProgressSink() const {
+    if (!progressCallback_ && !progressSink_) {
+        return nullptr;
+    }
+
+    // Runs on the reporter thread; captures copies so it never touches the
+    // compressor while workers are writing to it
+    ProgressCallback callback = progressCallback_;
+    ProgressSink sampleSink = progressSink_;
+    return [callback, sampleSink](const ProgressSample& sample) {
+        if (sampleSink) {
+            sampleSink(sample);
+        }
+        if (callback) {
+            std::unordered_map<std::string, double> summary = {
+                {"progress", sample.progress},
+                {"elapsed_time", sample.elapsed},
+                {"estimated_remaining", sample.remaining},
+                {"processing_rate", sample.rate},
+                {"compression_ratio", static_cast<double>(sample.totalPixels) / std::max<int64_t>(1, sample.regions)},
+                {"total_pixels", static_cast<double>(sample.totalPixels)},
+                {"processed_pixels", static_cast<double>(sample.processedPixels)},
+                {"total_regions", static_cast<double>(sample.regions)}
+            };
+            callback(sample.progress, summary);
+        }
+    };
+}
+
+} // namespace ic
@@ -0,0 +1,136 @@
+#include "image_compressor_c.h"
+#include "image_compressor.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+struct ic_compressor {
+    std::unique_ptr<ic::ImageCompressor> compressor;
+    std::vector<uint8_t> encoded;
+    std::string error;
+};
+
+namespace {
+
+const char* extensionFor(ic_format format) {
+    switch (format) {
+        case IC_FORMAT_REGION_MAP: return "icr";
+        case IC_FORMAT_RGB: return "rgb";
+        case IC_FORMAT_PPM: return "ppm";
+        case IC_FORMAT_PNG: return "png";
+        case IC_FORMAT_JPEG: return "jpg";
+        case IC_FORMAT_BMP: return "bmp";
+        default: return nullptr;
+    }
+}
+
+ic_status fail(ic_compressor* handle, ic_status status, const std::string& message) {
+    handle->error = message;
+    return status;
+}
+
+} // namespace
+
+extern "C" {
+
+void ic_options_init(ic_options* options) {
+    if (!options) {
+        return;
+    }
+    options->similarity_threshold = 0.9;
+    options->max_region_size = ic::ImageCompressor::kUnlimitedRegionSize;
+    options->algorithm = IC_ALGORITHM_ADAPTIVE;
+    options->adaptive = 1;
+    options->threads = 1;
+    options->min_region_size = 0;
+    options->entropy_coding = 1;
+}
+
+ic_compressor* ic_compressor_create(const ic_options* options) {
+    ic_options defaults;
+    ic_options_init(&defaults);
+    const ic_options& settings = options ? *options : defaults;
+    if (settings.algorithm < IC_ALGORITHM_ADAPTIVE || settings.algorithm > IC_ALGORITHM_UNION_FIND ||
+        settings.max_region_size < ic::ImageCompressor::kAutoRegionSize) {
+        return nullptr;
+    }
+
+    try {
+        auto handle = std::make_unique<ic_compressor>();
+        handle->compressor = std::make_unique<ic::ImageCompressor>(
+            settings.similarity_threshold, settings.max_region_size, nullptr,
+            static_cast<ic::ImageCompressor::Algorithm>(settings.algorithm), settings.adaptive != 0);
+        handle->compressor->setThreadCount(settings.threads);
+        handle->compressor->setMinRegionSize(settings.min_region_size);
+        handle->compressor->setEntropyCoding(settings.entropy_coding != 0);
+        handle->compressor->setReportEnabled(false);
+        return handle.release();
+    }
+    catch (const std::exception&) {
+        return nullptr;
+    }
+}
+
+void ic_compressor_destroy(ic_compressor* compressor) {
+    delete compressor;
+}
+
+ic_status ic_compress_rgb(ic_compressor* compressor, const unsigned char* rgb, int width, int height,
+                          size_t stride, ic_format format, ic_buffer* output) {
+    if (!compressor) {
+        return IC_ERROR_INVALID_ARGUMENT;
+    }
+    compressor->error.clear();
+    const char* extension = extensionFor(format);
+    if (!rgb || !output || width <= 0 || height <= 0 || !extension ||
+        (stride != 0 && stride < static_cast<size_t>(width) * 3)) {
+        return fail(compressor, IC_ERROR_INVALID_ARGUMENT, "invalid image buffer or output format");
+    }
+    output->data = nullptr;
+    output->size = 0;
+
+    try {
+        compressor->compressor->setImage(std::make_shared<ic::Image>(ic::Image::fromRgb(rgb, width, height, stride)));
+        if (!compressor->compressor->compress()) {
+            return fail(compressor, IC_ERROR_COMPRESSION, "compression failed");
+        }
+        if (!compressor->compressor->encodeCompressedImage(extension, compressor->encoded)) {
+            return fail(compressor, IC_ERROR_ENCODING, std::string("could not encode as ") + extension);
+        }
+    }
+    catch (const std::bad_alloc&) {
+        return fail(compressor, IC_ERROR_OUT_OF_MEMORY, "out of memory");
+    }
+    catch (const std::exception& e) {
+        return fail(compressor, IC_ERROR_COMPRESSION, e.what());
+    }
+
+    // Handed over with malloc so the buffer can outlive the compressor
+    output->data = static_cast<unsigned char*>(std::malloc(std::max<size_t>(1, compressor->encoded.size())));
+    if (!output->data) {
+        return fail(compressor, IC_ERROR_OUT_OF_MEMORY, "out of memory");
+    }
+    std::memcpy(output->data, compressor->encoded.data(), compressor->encoded.size());
+    output->size = compressor->encoded.size();
+    return IC_OK;
+}
+
+size_t ic_region_count(const ic_compressor* compressor) {
+    return compressor ? compressor->compressor->getRegionColors().size() : 0;
+}
+
+const char* ic_last_error(const ic_compressor* compressor) {
+    return compressor ? compressor->error.c_str() : "";
+}
+
+void ic_buffer_free(ic_buffer* buffer) {
+    if (buffer) {
+        std::free(buffer->data);
+        buffer->data = nullptr;
+        buffer->size = 0;
+    }
+}
+
+} // extern "C"
@@ -1,9 +1,17 @@
 #include "image_compressor.hpp"
+#include "batch_processor.hpp"
+#include "streaming_compressor.hpp"
+#include "utils/region_map.hpp"
 #include <iostream>
+#include <algorithm>
 #include <string>
 #include <filesystem>
+#include <fstream>
 #include <chrono>
+#include <future>
 #include <iomanip>
+#include <sstream>
+#include <unordered_map>
 
 // Simple command line arguments parser
 class ArgumentParser {
@@ -97,45 +105,32 @@ private:
 class ProgressBar {
 public:
     ProgressBar(const std::string& description = "Processing", int width = 50)
-        : description_(description), width_(width), startTime_(std::chrono::steady_clock::now()) {}
+        : description_(description), width_(width) {}
     
-    void update(double progress, const std::unordered_map<std::string, double>& stats = {}) {
-        auto now = std::chrono::steady_clock::now();
-        double elapsed = std::chrono::duration<double>(now - startTime_).count();
+    // Runs on the compressor's reporter thread, never on a worker
+    void update(const ic::ProgressSample& sample) {
+        double progress = sample.progress;
         
-        // Calculate ETA
-        double eta = (progress > 0.001) ? (elapsed / progress) - elapsed : 0.0;
-        
-        // Build the progress bar
+        // Build the whole line in one buffer
         int filled = static_cast<int>(width_ * progress);
         std::string bar;
+        bar.reserve(static_cast<size_t>(width_) * 3);
         for (int i = 0; i < width_; ++i) {
             bar += (i < filled) ? "█" : "░";
         }
         
-        // Format percentage
-        std::ostringstream percentStr;
-        percentStr << std::fixed << std::setprecision(2) << (progress * 100.0);
-        
-        // Base progress string
         std::ostringstream output;
-        output << "\r" << description_ << ": [" << bar << "] " 
-               << std::setw(6) << percentStr.str() << "% | "
-               << formatTime(elapsed) << " elapsed | ETA: " << formatTime(eta);
-        
-        // Add additional stats if available
-        if (stats.count("processing_rate") > 0) {
-            output << " | " << static_cast<int>(stats.at("processing_rate")) << " px/sec";
-        }
-        if (stats.count("total_regions") > 0) {
-            output << " | " << static_cast<int>(stats.at("total_regions")) << " regions";
-        }
+        output << "\r" << description_ << ": [" << bar << "] "
+               << std::fixed << std::setprecision(2) << std::setw(6) << (progress * 100.0) << "% | "
+               << formatTime(sample.elapsed) << " elapsed | ETA: " << formatTime(sample.remaining)
+               << " | " << static_cast<int64_t>(sample.rate) << " px/sec"
+               << " | " << sample.regions << " regions";
         
         // Print the progress
         std::cout << output.str() << std::flush;
         
         // Add a newline when complete
-        if (progress >= 1.0) {
+        if (sample.finished) {
             std::cout << std::endl;
         }
     }
@@ -143,7 +138,6 @@ public:
 private:
     std::string description_;
     int width_;
-    std::chrono::time_point<std::chrono::steady_clock> startTime_;
     
     std::string formatTime(double seconds) const {
         if (seconds < 0) return "Unknown";
@@ -169,16 +163,109 @@ private:
 // Print usage information
 void printUsage(const char* programName) {
     std::cout << "Usage: " << programName << " [options] input_image" << std::endl;
+    std::cout << "       " << programName << " [options] --batch=DIR" << std::endl;
+    std::cout << "       " << programName << " [options] --batch [DIR|FILE...]   (file list on stdin if none given)" << std::endl;
+    std::cout << "       " << programName << " [options] --sequence [--sequence=DIR | FRAME...]   (consecutive video frames)" << std::endl;
+    std::cout << "       " << programName << " [options] input.icr         (decode a region map to an image)" << std::endl;
     std::cout << "Options:" << std::endl;
-    std::cout << "  -o, --output=FILE           Path to save the compressed image" << std::endl;
+    std::cout << "  -o, --output=FILE           Path to save the compressed image; .icr writes the native region map" << std::endl;
+    std::cout << "  --no-entropy                Store the .icr label map without entropy coding" << std::endl;
     std::cout << "  -t, --threshold=VALUE       Similarity threshold (0.0-1.0) [default: 0.9]" << std::endl;
-    std::cout << "  -m, --max-region-size=SIZE  Maximum number of pixels in a region" << std::endl;
-    std::cout << "  -a, --algorithm=ALGO        Region-finding algorithm: adaptive or meanshift [default: adaptive]" << std::endl;
+    std::cout << "  -m, --max-region-size=SIZE  Maximum number of pixels in a region, 'unlimited' or 'auto'" << std::endl;
+    std::cout << "                              (auto: 1/20 of the image, bounded by free memory) [default: 0 (unlimited)]" << std::endl;
+    std::cout << "  -a, --algorithm=ALGO        Region-finding algorithm: adaptive, meanshift or unionfind [default: adaptive]" << std::endl;
+    std::cout << "  --running-mean              Grow against the running region/component mean instead of the seed color" << std::endl;
     std::cout << "  --no-adaptive               Disable adaptive thresholding (for adaptive algorithm)" << std::endl;
+    std::cout << "  --distance-mode=MODE        Similarity evaluation: direct or table [default: direct]" << std::endl;
+    std::cout << "  --connectivity=4|8          Pixel connectivity for region growth [default: 8]" << std::endl;
+    std::cout << "  --frontier=heap|bucket      Region frontier: binary heap or bucket queue (1/1024 steps) [default: heap]" << std::endl;
+    std::cout << "  --seed-order=ORDER          Seed order: raster, gradient (flattest first) or grid [default: raster]" << std::endl;
+    std::cout << "  --min-region=PIXELS         Merge smaller regions into their closest-colored neighbor [default: 0 (off)]" << std::endl;
+    std::cout << "  --target-regions=N          Merge closest-colored neighbors until N regions remain [default: 0 (off)]" << std::endl;
+    std::cout << "  --merge-delta=D             Merge neighbors whose mean colors are within D (RGB distance, 0-441) [default: 0 (off)]" << std::endl;
+    std::cout << "  --cache-size=ENTRIES        Similarity cache slots, rounded to a power of two, up to 16777216; 0 disables [default: 65536]" << std::endl;
+    std::cout << "  --adaptive-radius=N         Window radius for local variance in adaptive mode, up to 1024 [default: 3]" << std::endl;
+    std::cout << "  --pyramid=LEVELS            Adaptive: segment at 1/2^LEVELS scale, regrow only edges and detail [default: 0 = off]" << std::endl;
+    std::cout << "  --threads=N                 Worker threads for tiled mode and mean-shift; 0 = all cores [default: 1]" << std::endl;
+    std::cout << "  --tile-size=N               Tile edge length in pixels for parallel mode [default: 256]" << std::endl;
     std::cout << "  --no-progress               Disable progress bar display" << std::endl;
+    std::cout << "  --progress=MODE             Progress output: bar, json (JSON lines on stderr) or none [default: bar]" << std::endl;
+    std::cout << "  --progress-interval=SEC     Seconds between progress updates [default: 0.5]" << std::endl;
     std::cout << "  -v, --verbose               Enable verbose logging" << std::endl;
     std::cout << "  --report-only               Only generate a report without saving the image" << std::endl;
+    std::cout << "  --result-cache=DIR          Reuse results of identical images and options from an on-disk cache" << std::endl;
+    std::cout << "  --result-cache-size=MB      Least recently used entries are evicted above this size [default: 1024]" << std::endl;
+    std::cout << "  --metrics-json=FILE         Write the report with phase timings and counters as JSON" << std::endl;
+    std::cout << "  --stream                    Compress PPM/raw input strip by strip (union-find) without loading it whole" << std::endl;
+    std::cout << "  --strip-height=N            Rows per strip in streaming mode [default: 64]" << std::endl;
+    std::cout << "  --raw-size=WxH              Dimensions of headerless .raw/.rgb RGB input (memory-mapped)" << std::endl;
     std::cout << "  -h, --help                  Show this help message" << std::endl;
+    std::cout << "Batch options:" << std::endl;
+    std::cout << "  --batch[=DIR]               Compress every image in DIR, the given paths, or paths read from stdin" << std::endl;
+    std::cout << "  --output-dir=DIR            Directory for batch and sequence outputs [default: next to each input]" << std::endl;
+    std::cout << "  --output-format=EXT         Extension (icr, png, ...) of batch and sequence outputs [default: the input's]" << std::endl;
+    std::cout << "  --sequence[=DIR]            Compress frames in order, regrowing only blocks that changed since the last frame" << std::endl;
+    std::cout << "  --decode-workers=N          Image decoding threads [default: 2]" << std::endl;
+    std::cout << "  --batch-workers=N           Compression threads; 0 = all cores [default: 0]" << std::endl;
+    std::cout << "  --encode-workers=N          Image encoding/writing threads [default: 2]" << std::endl;
+    std::cout << "  --queue-depth=N             Images buffered between pipeline stages [default: 4]" << std::endl;
+}
+
+// Write JSON for --metrics-json=FILE; false if the file can't be written
+template <typename Writer>
+bool writeMetricsJson(const std::string& path, Writer write) {
+    std::ofstream file(path);
+    if (!file) {
+        std::cerr << "Error: Failed to write metrics to '" << path << "'" << std::endl;
+        return false;
+    }
+    write(file);
+    return static_cast<bool>(file);
+}
+
+// Parse --raw-size=WxH for headerless RGB input
+bool parseRawSize(const ArgumentParser& args, int& width, int& height) {
+    char separator = 0;
+    std::istringstream size(args.getOption("raw-size"));
+    if (!(size >> width >> separator >> height) || separator != 'x' || width <= 0 || height <= 0) {
+        std::cerr << "Error: Raw input needs --raw-size=WxH" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Collect batch inputs from --batch=DIR, positional paths, or stdin
+std::vector<std::string> collectBatchInputs(const ArgumentParser& args) {
+    std::vector<std::string> paths;
+    std::string batchValue = args.getOption("batch");
+    if (batchValue != "true" && batchValue != "-") {
+        paths.push_back(batchValue);
+    }
+    else if (batchValue == "true") {
+        paths = args.getPositionalArgs();
+    }
+
+    std::vector<std::string> inputs;
+    if (paths.empty()) {
+        std::string line;
+        while (std::getline(std::cin, line)) {
+            if (!line.empty()) {
+                inputs.push_back(line);
+            }
+        }
+        return inputs;
+    }
+
+    for (const auto& path : paths) {
+        if (std::filesystem::is_directory(path)) {
+            auto images = ic::BatchProcessor::listImages(path);
+            inputs.insert(inputs.end(), images.begin(), images.end());
+        }
+        else {
+            inputs.push_back(path);
+        }
+    }
+    return inputs;
 }
 
 int main(int argc, char** argv) {
@@ -193,26 +280,95 @@ int main(int argc, char** argv) {
     
     // Get positional arguments
     const auto& positionalArgs = args.getPositionalArgs();
-    if (positionalArgs.empty()) {
+    bool batchMode = args.hasOption("batch");
+    bool sequenceMode = args.hasOption("sequence");
+    if (positionalArgs.empty() && !batchMode && !(sequenceMode && args.getOption("sequence") != "true")) {
         std::cerr << "Error: No input image specified" << std::endl;
         printUsage(argv[0]);
         return 1;
     }
     
-    std::string inputImage = positionalArgs[0];
+    bool multiImage = batchMode || sequenceMode;
+    std::string inputImage = multiImage ? "" : positionalArgs[0];
     
     // Check if input file exists
-    if (!std::filesystem::exists(inputImage)) {
+    if (!multiImage && !std::filesystem::exists(inputImage)) {
         std::cerr << "Error: Input file '" << inputImage << "' not found" << std::endl;
         return 1;
     }
     
+    // Decode a region map back to an image
+    if (!multiImage && ic::RegionMap::isRegionMapPath(inputImage)) {
+        std::string outputPath = args.getOption("o", args.getOption("output"));
+        if (outputPath.empty()) {
+            outputPath = std::filesystem::path(inputImage).stem().string() + "_decoded.png";
+        }
+        try {
+            ic::RegionMap regionMap = ic::RegionMap::load(inputImage);
+            std::cout << "Decoded region map: " << regionMap.getWidth() << "x" << regionMap.getHeight()
+                      << ", " << regionMap.getPalette().size() << " regions" << std::endl;
+            if (!regionMap.render().save(outputPath)) {
+                std::cerr << "Error: Failed to save decoded image" << std::endl;
+                return 1;
+            }
+            std::cout << "Success! Decoded image saved to '" << outputPath << "'" << std::endl;
+            return 0;
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+    
     // Get options
     double threshold = args.getDoubleOption("t", args.getDoubleOption("threshold", 0.9));
-    int maxRegionSize = args.getIntOption("m", args.getIntOption("max-region-size", 0));
+    if (!(threshold >= 0.0 && threshold <= 1.0)) {
+        std::cerr << "Error: --threshold must be between 0.0 and 1.0" << std::endl;
+        return 1;
+    }
+    std::string maxRegionOption = args.getOption("m", args.getOption("max-region-size", "0"));
+    int maxRegionSize = ic::ImageCompressor::kUnlimitedRegionSize;
+    if (maxRegionOption == "auto") {
+        maxRegionSize = ic::ImageCompressor::kAutoRegionSize;
+    }
+    else if (maxRegionOption != "unlimited") {
+        try {
+            maxRegionSize = std::stoi(maxRegionOption);
+        }
+        catch (...) {
+            std::cerr << "Error: --max-region-size must be a pixel count, 'unlimited' or 'auto'" << std::endl;
+            return 1;
+        }
+        if (maxRegionSize < 0) {
+            std::cerr << "Error: --max-region-size must not be negative" << std::endl;
+            return 1;
+        }
+    }
     bool noProgress = args.hasOption("no-progress");
     bool reportOnly = args.hasOption("report-only");
     bool noAdaptive = args.hasOption("no-adaptive");
+    bool runningMean = args.hasOption("running-mean");
+    int adaptiveRadius = args.getIntOption("adaptive-radius", ic::AdaptiveRegionGrower::kDefaultAdaptiveRadius);
+    if (adaptiveRadius < 0 || adaptiveRadius > ic::LocalStatistics::kMaxRadius) {
+        std::cerr << "Error: --adaptive-radius must be between 0 and " << ic::LocalStatistics::kMaxRadius << std::endl;
+        return 1;
+    }
+    int pyramidLevels = args.getIntOption("pyramid", 0);
+    if (pyramidLevels < 0 || pyramidLevels > 8) {
+        std::cerr << "Error: --pyramid must be between 0 and 8" << std::endl;
+        return 1;
+    }
+    int threads = args.getIntOption("threads", 1);
+    int tileSize = args.getIntOption("tile-size", 0);
+    if (threads < 0 || tileSize < 0) {
+        std::cerr << "Error: --threads and --tile-size must not be negative" << std::endl;
+        return 1;
+    }
+    int cacheSize = args.getIntOption("cache-size", static_cast<int>(ic::SimilarityCache::kDefaultEntries));
+    if (cacheSize < 0 || static_cast<size_t>(cacheSize) > ic::SimilarityCache::kMaxEntries) {
+        std::cerr << "Error: --cache-size must be between 0 and " << ic::SimilarityCache::kMaxEntries << std::endl;
+        return 1;
+    }
     
     // Determine algorithm
     ic::ImageCompressor::Algorithm algorithm = ic::ImageCompressor::Algorithm::ADAPTIVE;
@@ -220,6 +376,256 @@ int main(int argc, char** argv) {
     if (algoStr == "meanshift") {
         algorithm = ic::ImageCompressor::Algorithm::MEAN_SHIFT;
     }
+    else if (algoStr == "unionfind") {
+        algorithm = ic::ImageCompressor::Algorithm::UNION_FIND;
+    }
+    
+    // Determine how color similarity is evaluated
+    ic::DistanceMode distanceMode = ic::DistanceMode::DIRECT;
+    std::string distanceStr = args.getOption("distance-mode", "direct");
+    if (distanceStr == "table") {
+        distanceMode = ic::DistanceMode::TABLE;
+    }
+    else if (distanceStr != "direct") {
+        std::cerr << "Error: Unknown distance mode '" << distanceStr << "'" << std::endl;
+        return 1;
+    }
+    
+    // Determine pixel connectivity
+    int connectivityValue = args.getIntOption("connectivity", 8);
+    if (connectivityValue != 4 && connectivityValue != 8) {
+        std::cerr << "Error: --connectivity must be 4 or 8" << std::endl;
+        return 1;
+    }
+    ic::Connectivity connectivity = connectivityValue == 4 ? ic::Connectivity::FOUR : ic::Connectivity::EIGHT;
+    
+    // Determine the frontier structure
+    ic::FrontierMode frontierMode = ic::FrontierMode::HEAP;
+    std::string frontierStr = args.getOption("frontier", "heap");
+    if (frontierStr == "bucket") {
+        frontierMode = ic::FrontierMode::BUCKET;
+    }
+    else if (frontierStr != "heap") {
+        std::cerr << "Error: Unknown frontier '" << frontierStr << "'" << std::endl;
+        return 1;
+    }
+    
+    // Determine the seed order
+    ic::SeedOrder seedOrder = ic::SeedOrder::RASTER;
+    std::string seedOrderStr = args.getOption("seed-order", "raster");
+    if (seedOrderStr == "gradient") {
+        seedOrder = ic::SeedOrder::GRADIENT;
+    }
+    else if (seedOrderStr == "grid") {
+        seedOrder = ic::SeedOrder::GRID;
+    }
+    else if (seedOrderStr != "raster") {
+        std::cerr << "Error: Unknown seed order '" << seedOrderStr << "'" << std::endl;
+        return 1;
+    }
+    int minRegionSize = args.getIntOption("min-region", 0);
+    int targetRegions = args.getIntOption("target-regions", 0);
+    double mergeDelta = args.getDoubleOption("merge-delta", 0.0);
+    if (minRegionSize < 0 || targetRegions < 0 || mergeDelta < 0.0) {
+        std::cerr << "Error: --min-region, --target-regions and --merge-delta must not be negative" << std::endl;
+        return 1;
+    }
+    ic::MergeTarget mergeTarget;
+    mergeTarget.regionCount = static_cast<size_t>(targetRegions);
+    mergeTarget.maxColorDelta = mergeDelta;
+    
+    // One cache for every compressor of the run
+    std::shared_ptr<ic::ResultCache> resultCache;
+    if (args.hasOption("result-cache")) {
+        int cacheMegabytes = args.getIntOption("result-cache-size", 1024);
+        if (cacheMegabytes <= 0) {
+            std::cerr << "Error: --result-cache-size must be positive" << std::endl;
+            return 1;
+        }
+        try {
+            resultCache = std::make_shared<ic::ResultCache>(args.getOption("result-cache"),
+                                                            static_cast<uint64_t>(cacheMegabytes) * 1024 * 1024);
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+    
+    // Apply the options shared by single-image and batch mode
+    auto configure = [&](ic::ImageCompressor& compressor) {
+        compressor.setSimilarityCacheSize(static_cast<size_t>(cacheSize));
+        compressor.setDistanceMode(distanceMode);
+        compressor.setConnectivity(connectivity);
+        compressor.setFrontierMode(frontierMode);
+        compressor.setSeedOrder(seedOrder);
+        compressor.setMinRegionSize(minRegionSize);
+        compressor.setMergeTarget(mergeTarget);
+        compressor.setRunningMean(runningMean);
+        compressor.setEntropyCoding(!args.hasOption("no-entropy"));
+        compressor.setAdaptiveRadius(adaptiveRadius);
+        compressor.setPyramidLevels(pyramidLevels);
+        compressor.setThreadCount(threads);
+        compressor.setTileSize(tileSize);
+        compressor.setResultCache(resultCache);
+    };
+    
+    // Batch and sequence outputs keep the input's extension unless asked
+    std::string outputExtension = args.getOption("output-format");
+    if (!outputExtension.empty() && outputExtension[0] != '.') {
+        outputExtension = "." + outputExtension;
+    }
+    
+    if (batchMode) {
+        ic::BatchOptions batchOptions;
+        batchOptions.decodeWorkers = args.getIntOption("decode-workers", 2);
+        batchOptions.compressWorkers = args.getIntOption("batch-workers", 0);
+        batchOptions.encodeWorkers = args.getIntOption("encode-workers", 2);
+        batchOptions.queueDepth = static_cast<size_t>(std::max(1, args.getIntOption("queue-depth", 4)));
+        batchOptions.outputDir = args.getOption("output-dir");
+        batchOptions.outputSuffix = "_compressed_" + algoStr;
+        batchOptions.outputExtension = outputExtension;
+        batchOptions.reportOnly = reportOnly;
+        
+        try {
+            std::vector<std::string> inputs = collectBatchInputs(args);
+            if (inputs.empty()) {
+                std::cerr << "Error: No input images for batch mode" << std::endl;
+                return 1;
+            }
+            if (std::any_of(inputs.begin(), inputs.end(), ic::isRawPath) &&
+                !parseRawSize(args, batchOptions.rawWidth, batchOptions.rawHeight)) {
+                return 1;
+            }
+            
+            ic::BatchProcessor batch([&]() {
+                auto compressor = std::make_unique<ic::ImageCompressor>(
+                    threshold, maxRegionSize, nullptr, algorithm, !noAdaptive);
+                configure(*compressor);
+                return compressor;
+            }, batchOptions);
+            
+            std::cout << "Batch mode: " << inputs.size() << " images" << std::endl;
+            bool allSucceeded = batch.run(inputs);
+            batch.getStats().printReport();
+            if (args.hasOption("metrics-json") &&
+                !writeMetricsJson(args.getOption("metrics-json"), [](std::ostream& out) {
+                    // Jobs overlap in batch mode, so only process totals are meaningful
+                    out << "{\"metrics\": ";
+                    ic::metrics::collect().writeJson(out);
+                    out << "}" << std::endl;
+                })) {
+                return 1;
+            }
+            return allSucceeded ? 0 : 1;
+        }
+        catch (const std::exception& e) {
+            std::cerr << std::endl << "Error during batch compression: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+    
+    // Frames in order through one compressor, so each frame only regrows
+    // what changed since the previous one
+    if (sequenceMode) {
+        std::string sequenceValue = args.getOption("sequence");
+        std::vector<std::string> frames = sequenceValue == "true" ? positionalArgs
+                                                                  : ic::BatchProcessor::listImages(sequenceValue);
+        if (frames.empty()) {
+            std::cerr << "Error: No frames for sequence mode" << std::endl;
+            return 1;
+        }
+        std::string outputDir = args.getOption("output-dir");
+        
+        try {
+            if (!outputDir.empty()) {
+                std::filesystem::create_directories(outputDir);
+            }
+            ic::ImageCompressor compressor(threshold, maxRegionSize, nullptr, algorithm, !noAdaptive);
+            configure(compressor);
+            compressor.setSequenceMode(true);
+            compressor.setReportEnabled(args.hasOption("v") || args.hasOption("verbose"));
+            
+            int rawWidth = 0;
+            int rawHeight = 0;
+            if (std::any_of(frames.begin(), frames.end(), ic::isRawPath) && !parseRawSize(args, rawWidth, rawHeight)) {
+                return 1;
+            }
+            auto decodeFrame = [&](size_t i) {
+                bool raw = ic::isRawPath(frames[i]);
+                return compressor.decodeAsync(frames[i], nullptr, raw ? rawWidth : 0, raw ? rawHeight : 0);
+            };
+            
+            // Frame i+1 decodes and frame i-1 encodes while frame i is segmented
+            auto sequenceStart = std::chrono::steady_clock::now();
+            int64_t totalPixels = 0;
+            int64_t regrownPixels = 0;
+            std::vector<std::pair<std::string, std::future<bool>>> writes;
+            std::future<std::shared_ptr<ic::Image>> nextFrame = decodeFrame(0);
+            for (size_t i = 0; i < frames.size(); ++i) {
+                const std::string& frame = frames[i];
+                std::shared_ptr<ic::Image> image = nextFrame.get();
+                if (!image) {
+                    std::cerr << "Error: Failed to load frame '" << frame << "'" << std::endl;
+                    return 1;
+                }
+                if (i + 1 < frames.size()) {
+                    nextFrame = decodeFrame(i + 1);
+                }
+                if (!compressor.segmentAsync(std::move(image)).get()) {
+                    std::cerr << "Error: Failed to compress frame '" << frame << "'" << std::endl;
+                    return 1;
+                }
+                
+                std::filesystem::path input(frame);
+                std::filesystem::path directory = outputDir.empty() ? input.parent_path()
+                                                                    : std::filesystem::path(outputDir);
+                std::string extension = outputExtension.empty() ? input.extension().string() : outputExtension;
+                std::string framePath = (directory / (input.stem().string() + "_compressed_" + algoStr +
+                                                      extension)).string();
+                if (!reportOnly) {
+                    writes.emplace_back(framePath, compressor.encodeAsync(framePath));
+                }
+                
+                auto summary = compressor.getStats().getSummary(true);
+                totalPixels += static_cast<int64_t>(summary["total_pixels"]);
+                regrownPixels += static_cast<int64_t>(summary["regrown_pixels"]);
+                std::cout << "Frame " << (i + 1) << "/" << frames.size() << ": " << frame << " -> "
+                          << (reportOnly ? std::string("(not saved)") : framePath) << ", "
+                          << static_cast<int>(summary["total_regions"]) << " regions, "
+                          << std::fixed << std::setprecision(1)
+                          << 100.0 * summary["regrown_pixels"] / std::max(1.0, summary["total_pixels"])
+                          << "% regrown, " << std::setprecision(0) << summary["elapsed_time"] * 1000.0 << " ms"
+                          << std::endl;
+            }
+            
+            for (auto& write : writes) {
+                if (!write.second.get()) {
+                    std::cerr << "Error: Failed to save frame '" << write.first << "'" << std::endl;
+                    return 1;
+                }
+            }
+            
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - sequenceStart).count();
+            std::cout << "Sequence: " << frames.size() << " frames in " << std::setprecision(2) << seconds << " s ("
+                      << frames.size() / std::max(1e-9, seconds) << " frames/second), "
+                      << std::setprecision(1) << 100.0 * regrownPixels / std::max<int64_t>(1, totalPixels)
+                      << "% of pixels regrown" << std::endl;
+            if (args.hasOption("metrics-json") &&
+                !writeMetricsJson(args.getOption("metrics-json"), [](std::ostream& out) {
+                    out << "{\"metrics\": ";
+                    ic::metrics::collect().writeJson(out);
+                    out << "}" << std::endl;
+                })) {
+                return 1;
+            }
+            return 0;
+        }
+        catch (const std::exception& e) {
+            std::cerr << std::endl << "Error during sequence compression: " << e.what() << std::endl;
+            return 1;
+        }
+    }
     
     // Determine output path
     std::string outputPath;
@@ -237,30 +643,110 @@ int main(int argc, char** argv) {
         outputPath = stem.string() + "_compressed_" + algoStr + extension.string();
     }
     
-    // Create a progress bar
+    // Progress: a console bar, JSON lines on stderr for schedulers, or none
+    std::string progressMode = noProgress ? "none" : args.getOption("progress", "bar");
+    if (progressMode != "bar" && progressMode != "json" && progressMode != "none") {
+        std::cerr << "Error: --progress must be bar, json or none" << std::endl;
+        return 1;
+    }
+    double progressInterval = args.getDoubleOption("progress-interval", 0.5);
+    
     ProgressBar progressBar("Compressing image (" + algoStr + ")");
+    ic::ProgressSink progressSink;
+    if (progressMode == "bar") {
+        progressSink = [&progressBar](const ic::ProgressSample& sample) {
+            progressBar.update(sample);
+        };
+    }
+    else if (progressMode == "json") {
+        progressSink = [](const ic::ProgressSample& sample) {
+            sample.writeJson(std::cerr);
+            std::cerr << std::endl;
+        };
+    }
     
-    // Create a progress callback
-    ic::ProgressCallback progressCallback = [&progressBar, noProgress](double progress, 
-                                                        const std::unordered_map<std::string, double>& stats) {
-        if (!noProgress) {
-            progressBar.update(progress, stats);
+    // Compress strip by strip without holding the image in memory
+    if (args.hasOption("stream")) {
+        if (!ic::isRawPath(outputPath) && std::filesystem::path(outputPath).extension() != ".ppm") {
+            std::cerr << "Error: Streaming mode writes .ppm, .raw or .rgb output" << std::endl;
+            return 1;
         }
-    };
+        ic::StreamingOptions streamOptions;
+        streamOptions.stripHeight = args.getIntOption("strip-height", streamOptions.stripHeight);
+        streamOptions.similarityThreshold = threshold;
+        streamOptions.maxRegionSize = maxRegionSize;
+        streamOptions.runningMean = runningMean;
+        streamOptions.connectivity = connectivity;
+        streamOptions.distanceMode = distanceMode;
+        streamOptions.progressInterval = progressInterval;
+        
+        try {
+            std::unique_ptr<ic::RowReader> reader;
+            if (ic::isRawPath(inputImage)) {
+                int width = 0;
+                int height = 0;
+                if (!parseRawSize(args, width, height)) {
+                    return 1;
+                }
+                reader = std::make_unique<ic::RowReader>(inputImage, width, height);
+            }
+            else {
+                reader = std::make_unique<ic::RowReader>(inputImage);
+            }
+            
+            if (streamOptions.maxRegionSize == ic::ImageCompressor::kAutoRegionSize) {
+                streamOptions.maxRegionSize = ic::ImageCompressor::autoMaxRegionSize(reader->getWidth(), reader->getHeight());
+            }
+            
+            std::cout << "Streaming image: " << inputImage << " (" << reader->getWidth() << "x"
+                      << reader->getHeight() << ", " << streamOptions.stripHeight << "-row strips)" << std::endl;
+            ic::StreamingCompressor streamer(streamOptions, progressSink);
+            if (!streamer.run(*reader, outputPath)) {
+                std::cerr << "Error: Compression failed" << std::endl;
+                return 1;
+            }
+            streamer.getStats().printReport();
+            std::cout << "Peak active regions: " << streamer.getPeakActiveRegions() << std::endl;
+            if (args.hasOption("metrics-json") &&
+                !writeMetricsJson(args.getOption("metrics-json"), [&streamer](std::ostream& out) {
+                    streamer.getStats().writeJson(out);
+                })) {
+                return 1;
+            }
+            std::cout << "Success! Compressed image saved to '" << outputPath << "'" << std::endl;
+            return 0;
+        }
+        catch (const std::exception& e) {
+            std::cerr << std::endl << "Error during compression: " << e.what() << std::endl;
+            return 1;
+        }
+    }
     
     try {
         // Create the compressor
         ic::ImageCompressor compressor(
             threshold,
             maxRegionSize,
-            progressCallback,
+            nullptr,
             algorithm,
             !noAdaptive
         );
+        configure(compressor);
+        compressor.setProgressSink(progressSink);
+        compressor.setProgressInterval(progressInterval);
         
-        // Load the image
+        // Load the image; raw RGB has no header, so it's mapped with the
+        // dimensions given on the command line
         std::cout << "Loading image: " << inputImage << std::endl;
-        if (!compressor.loadImage(inputImage)) {
+        if (ic::isRawPath(inputImage)) {
+            int width = 0;
+            int height = 0;
+            if (!parseRawSize(args, width, height)) {
+                return 1;
+            }
+            compressor.setImage(std::make_shared<ic::Image>(ic::Image::mapRaw(inputImage, width, height)));
+        }
+        else if (!compressor.loadImage(inputImage)) {
             std::cerr << "Error: Failed to load image" << std::endl;
             return 1;
         }
@@ -284,6 +770,13 @@ int main(int argc, char** argv) {
             std::cout << "Report-only mode: Image was not saved" << std::endl;
         }
         
+        if (args.hasOption("metrics-json") &&
+            !writeMetricsJson(args.getOption("metrics-json"), [&compressor](std::ostream& out) {
+                compressor.getStats().writeJson(out);
+            })) {
+            return 1;
+        }
+        
         return 0;
     } 
     catch (const std::exception& e) {
@@ -0,0 +1,302 @@
+#include "streaming_compressor.hpp"
+#include "utils/disjoint_set.hpp"
+#include "utils/metrics.hpp"
+#include "utils/region_sums.hpp"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <iostream>
+#include <stdexcept>
+
+namespace ic {
+
+namespace {
+
+// Spilled label codes: a final region id, or kPending | the component's
+// slot among those carried into the next strip
+constexpr uint32_t kPending = 0x80000000u;
+constexpr uint32_t kNone = 0xFFFFFFFFu;
+
+} // namespace
+
+StreamingCompressor::StreamingCompressor(StreamingOptions options, ProgressSink progressSink)
+    : options_(std::move(options)), progressSink_(std::move(progressSink)) {
+}
+
+bool StreamingCompressor::run(RowReader& input, const std::string& outputPath) {
+    if (options_.stripHeight <= 0) {
+        std::cerr << "Strip height must be positive" << std::endl;
+        return false;
+    }
+
+    std::string spillPath = outputPath + ".labels.tmp";
+    bool succeeded = false;
+    try {
+        succeeded = runPasses(input, outputPath, spillPath);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Streaming compression failed: " << e.what() << std::endl;
+    }
+
+    std::error_code ignored;
+    std::filesystem::remove(spillPath, ignored);
+    return succeeded;
+}
+
+bool StreamingCompressor::runPasses(RowReader& input, const std::string& outputPath,
+                                    const std::string& spillPath) {
+    int width = input.getWidth();
+    int height = input.getHeight();
+    stats_ = CompressionStats();
+    stats_.start(width, height);
+    peakActiveRegions_ = 0;
+    metrics::Snapshot baseline = metrics::collect();
+
+    progress_.reset(static_cast<int64_t>(width) * height);
+    std::unique_ptr<ProgressReporter> reporter;
+    if (progressSink_) {
+        reporter = std::make_unique<ProgressReporter>(progress_, options_.progressInterval, progressSink_);
+    }
+
+    std::fstream spill(spillPath, std::ios::in | std::ios::out | std::ios::trunc | std::ios::binary);
+    if (!spill) {
+        throw std::runtime_error("Failed to create temporary file: " + spillPath);
+    }
+
+    // Pass 1: label strips, finalize regions, spill label codes
+    std::vector<Color> palette;
+    std::vector<std::vector<uint32_t>> forward;
+    bool labeled;
+    auto labelStart = std::chrono::steady_clock::now();
+    if (options_.distanceMode == DistanceMode::TABLE) {
+        const ColorTables& tables = ColorTables::instance();
+        int32_t bound = ColorTables::similarityToSquaredThreshold(options_.similarityThreshold);
+        auto similar = [&tables, bound](const Color& a, const Color& b) {
+            return tables.squaredDistance(a, b) <= bound;
+        };
+        labeled = options_.connectivity == Connectivity::FOUR
+                ? labelStrips<Connectivity::FOUR>(input, spill, palette, forward, similar)
+                : labelStrips<Connectivity::EIGHT>(input, spill, palette, forward, similar);
+    }
+    else {
+        double threshold = options_.similarityThreshold;
+        auto similar = [threshold](const Color& a, const Color& b) {
+            return colorSimilarity(a, b) >= threshold;
+        };
+        labeled = options_.connectivity == Connectivity::FOUR
+                ? labelStrips<Connectivity::FOUR>(input, spill, palette, forward, similar)
+                : labelStrips<Connectivity::EIGHT>(input, spill, palette, forward, similar);
+    }
+    if (!labeled) {
+        return false;
+    }
+    metrics::addTime(metrics::Phase::REGION_GROWTH, std::chrono::steady_clock::now() - labelStart);
+
+    // Resolve pending codes back to front; the last strip has none
+    for (size_t strip = forward.size(); strip-- > 0;) {
+        for (uint32_t& code : forward[strip]) {
+            if (code & kPending) {
+                code = forward[strip + 1][code & ~kPending];
+            }
+        }
+    }
+
+    // Pass 2: turn spilled codes into output rows
+    auto encodeStart = std::chrono::steady_clock::now();
+    spill.seekg(0);
+    RowWriter writer(outputPath, width, height);
+    int stripHeight = options_.stripHeight;
+    std::vector<uint32_t> codes(static_cast<size_t>(width) * stripHeight);
+    std::vector<Color> rows(codes.size());
+    for (size_t strip = 0, y = 0; y < static_cast<size_t>(height); ++strip, y += stripHeight) {
+        int count = std::min(stripHeight, height - static_cast<int>(y));
+        size_t pixels = static_cast<size_t>(count) * width;
+        spill.read(reinterpret_cast<char*>(codes.data()), static_cast<std::streamsize>(pixels * sizeof(uint32_t)));
+        if (!spill) {
+            throw std::runtime_error("Failed to read temporary file: " + spillPath);
+        }
+        for (size_t i = 0; i < pixels; ++i) {
+            uint32_t code = codes[i];
+            if (code & kPending) {
+                code = forward[strip + 1][code & ~kPending];
+            }
+            rows[i] = palette[code];
+        }
+        if (!writer.writeRows(rows.data(), count)) {
+            throw std::runtime_error("Failed to write " + outputPath);
+        }
+    }
+    if (!writer.close()) {
+        throw std::runtime_error("Failed to write " + outputPath);
+    }
+
+    metrics::addTime(metrics::Phase::ENCODE, std::chrono::steady_clock::now() - encodeStart);
+
+    // Strips merge across their seams, so there are no truncations to count
+    stats_.setRegionSizeCap(std::max(0, options_.maxRegionSize), 0);
+    stats_.finish();
+    stats_.setMetrics(metrics::collect() - baseline);
+    if (reporter) {
+        reporter->stop();
+    }
+    return true;
+}
+
+template <Connectivity C, typename Similar>
+bool StreamingCompressor::labelStrips(RowReader& input, std::fstream& spill, std::vector<Color>& palette,
+                                      std::vector<std::vector<uint32_t>>& forward, Similar similar) {
+    int width = input.getWidth();
+    int height = input.getHeight();
+    int stripHeight = options_.stripHeight;
+    size_t stripPixels = static_cast<size_t>(width) * stripHeight;
+    uint64_t cap = options_.maxRegionSize > 0 ? static_cast<uint64_t>(options_.maxRegionSize) : UINT64_MAX;
+
+    std::vector<Color> pixels(stripPixels);
+    std::vector<uint32_t> labels(stripPixels);
+
+    // Last row of the previous strip; labels are carried-in slots
+    std::vector<Color> aboveColors(width);
+    std::vector<uint32_t> aboveLabels(width);
+    std::vector<RegionSums> carry;
+
+    DisjointSet sets;
+    std::vector<RegionSums> sums;
+    std::vector<uint32_t> slotOf;
+    std::vector<uint32_t> finalOf;
+
+    // Strip 0 has no carried-in components
+    forward.assign(1, std::vector<uint32_t>());
+
+    for (int strip = 0;; ++strip) {
+        int rows = input.readRows(pixels.data(), stripHeight);
+        if (rows == 0) {
+            break;
+        }
+        bool lastStrip = input.getRowsRead() == height;
+
+        // Components carried in from the previous strip take ids 0..k-1
+        size_t carriedIn = carry.size();
+        size_t finalizedBefore = palette.size();
+        sets.reset(carriedIn);
+        sums = std::move(carry);
+        carry.clear();
+
+        for (int y = 0; y < rows; ++y) {
+            const Color* row = &pixels[static_cast<size_t>(y) * width];
+            uint32_t* rowLabels = &labels[static_cast<size_t>(y) * width];
+            bool hasAbove = y > 0 || strip > 0;
+            const Color* above = y > 0 ? row - width : aboveColors.data();
+            const uint32_t* aboveRowLabels = y > 0 ? rowLabels - width : aboveLabels.data();
+
+            for (int x = 0; x < width; ++x) {
+                const Color& color = row[x];
+                uint32_t label = kNone;
+
+                // Same join/bridge rule as UnionFindSegmenter
+                auto consider = [&](uint32_t neighborLabel, const Color& neighborColor) {
+                    uint32_t neighbor = sets.find(neighborLabel);
+                    if (label == kNone) {
+                        Color other = options_.runningMean ? sums[neighbor].mean() : neighborColor;
+                        if (sums[neighbor].count + 1 <= cap && similar(color, other)) {
+                            label = neighbor;
+                            sums[neighbor].add(color);
+                        }
+                        return;
+                    }
+                    uint32_t own = sets.find(label);
+                    if (own == neighbor) {
+                        return;
+                    }
+                    bool bridge = options_.runningMean ? similar(sums[own].mean(), sums[neighbor].mean())
+                                                       : similar(color, neighborColor);
+                    if (bridge && static_cast<uint64_t>(sums[own].count) + sums[neighbor].count <= cap) {
+                        uint32_t root = sets.unite(own, neighbor);
+                        sums[root].merge(sums[root == own ? neighbor : own]);
+                    }
+                };
+
+                // W, NW, N, NE (or W, N)
+                if (x > 0) {
+                    consider(rowLabels[x - 1], row[x - 1]);
+                }
+                if (hasAbove) {
+                    if (C == Connectivity::EIGHT && x > 0) {
+                        consider(aboveRowLabels[x - 1], above[x - 1]);
+                    }
+                    consider(aboveRowLabels[x], above[x]);
+                    if (C == Connectivity::EIGHT && x + 1 < width) {
+                        consider(aboveRowLabels[x + 1], above[x + 1]);
+                    }
+                }
+
+                if (label == kNone) {
+                    label = sets.add();
+                    sums.emplace_back();
+                    sums.back().add(color);
+                }
+                rowLabels[x] = label;
+            }
+        }
+
+        // Components on the strip's last row may still grow and are carried
+        // on; everything else is final
+        slotOf.assign(sets.count(), kNone);
+        finalOf.assign(sets.count(), kNone);
+        if (!lastStrip) {
+            const uint32_t* lastRow = &labels[static_cast<size_t>(rows - 1) * width];
+            for (int x = 0; x < width; ++x) {
+                uint32_t root = sets.find(lastRow[x]);
+                if (slotOf[root] == kNone) {
+                    slotOf[root] = static_cast<uint32_t>(carry.size());
+                    carry.push_back(sums[root]);
+                }
+                aboveLabels[x] = slotOf[root];
+            }
+            std::copy(pixels.begin() + static_cast<size_t>(rows - 1) * width,
+                      pixels.begin() + static_cast<size_t>(rows) * width, aboveColors.begin());
+        }
+        peakActiveRegions_ = std::max(peakActiveRegions_, carry.size());
+
+        auto codeOf = [&](uint32_t id) {
+            uint32_t root = sets.find(id);
+            if (slotOf[root] != kNone) {
+                return kPending | slotOf[root];
+            }
+            if (finalOf[root] == kNone) {
+                if (palette.size() >= kPending) {
+                    throw std::runtime_error("Too many regions for streaming mode");
+                }
+                finalOf[root] = static_cast<uint32_t>(palette.size());
+                palette.push_back(sums[root].mean());
+                stats_.addRegion(static_cast<int>(sums[root].count));
+            }
+            return finalOf[root];
+        };
+
+        if (strip > 0) {
+            std::vector<uint32_t> carriedCodes(carriedIn);
+            for (size_t slot = 0; slot < carriedIn; ++slot) {
+                carriedCodes[slot] = codeOf(static_cast<uint32_t>(slot));
+            }
+            forward.push_back(std::move(carriedCodes));
+        }
+
+        size_t pixelCount = static_cast<size_t>(rows) * width;
+        for (size_t i = 0; i < pixelCount; ++i) {
+            labels[i] = codeOf(labels[i]);
+        }
+        spill.write(reinterpret_cast<const char*>(labels.data()),
+                    static_cast<std::streamsize>(pixelCount * sizeof(uint32_t)));
+        if (!spill) {
+            std::cerr << "Failed to write temporary label file" << std::endl;
+            return false;
+        }
+
+        progress_.add(static_cast<int64_t>(pixelCount), static_cast<int64_t>(palette.size() - finalizedBefore));
+    }
+
+    return true;
+}
+
+} // namespace ic
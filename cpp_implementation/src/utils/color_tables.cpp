@@ -0,0 +1,46 @@
+#include "utils/color_tables.hpp"
+#include <cmath>
+#include <algorithm>
+
+namespace ic {
+
+ColorTables::ColorTables() {
+    for (int delta = -255; delta <= 255; ++delta) {
+        squared_[delta + 255] = delta * delta;
+    }
+}
+
+const ColorTables& ColorTables::instance() {
+    static const ColorTables tables;
+    return tables;
+}
+
+double similarityFromSquaredDistance(int32_t squaredDistance) {
+    // Must stay identical to colorSimilarity(): the sum of squared integer
+    // deltas is exact in double, so only the sqrt and the division remain
+    const double maxDistance = 441.67;
+    double distance = std::sqrt(static_cast<double>(squaredDistance));
+    return 1.0 - (distance / maxDistance);
+}
+
+int32_t ColorTables::similarityToSquaredThreshold(double threshold) {
+    if (similarityFromSquaredDistance(0) < threshold) {
+        return -1;
+    }
+
+    // Estimate from the closed form, then settle the boundary with the exact
+    // expression so rounding can never disagree with the double path
+    double estimate = (1.0 - threshold) * 441.67;
+    int32_t squared = estimate <= 0.0 ? 0
+                    : static_cast<int32_t>(std::min(estimate * estimate, static_cast<double>(kMaxSquaredDistance)));
+
+    while (squared > 0 && similarityFromSquaredDistance(squared) < threshold) {
+        --squared;
+    }
+    while (squared < kMaxSquaredDistance && similarityFromSquaredDistance(squared + 1) >= threshold) {
+        ++squared;
+    }
+    return squared;
+}
+
+} // namespace ic
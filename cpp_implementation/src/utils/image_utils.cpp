@@ -1,5 +1,10 @@
 #include "utils/image_utils.hpp"
+#include "utils/mapped_file.hpp"
+#include "utils/metrics.hpp"
+#include "utils/row_io.hpp"
 #include <cmath>
+#include <cstring>
+#include <fstream>
 #include <stdexcept>
 #include <algorithm>
 
@@ -12,13 +17,27 @@
 namespace ic {
 
 Image::Image(int width, int height) 
-    : width_(width), height_(height), pixels_(width * height) {
+    : width_(width), height_(height) {
     if (width <= 0 || height <= 0) {
         throw std::invalid_argument("Invalid image dimensions");
     }
+    pixels_ = allocate(pixelCount());
 }
 
 Image::Image(const std::string& filename) {
+    metrics::ScopedTimer timer(metrics::Phase::DECODE);
+    
+    // Map PPM directly; anything stb reads but we can't map (ASCII P3,
+    // 16-bit) falls through to the decoder
+    if (isPpmPath(filename)) {
+        try {
+            *this = mapPpm(filename);
+            return;
+        }
+        catch (const std::exception&) {
+        }
+    }
+    
     int channels;
     unsigned char* data = stbi_load(filename.c_str(), &width_, &height_, &channels, 3);
     
@@ -26,62 +45,195 @@ Image::Image(const std::string& filename) {
         throw std::runtime_error("Failed to load image: " + filename);
     }
     
-    // Convert to our internal format
-    pixels_.resize(width_ * height_);
-    for (int y = 0; y < height_; ++y) {
-        for (int x = 0; x < width_; ++x) {
-            int idx = (y * width_ + x) * 3;
-            pixels_[getIndex(x, y)] = Color(data[idx], data[idx + 1], data[idx + 2]);
-        }
+    // stb_image already returns interleaved RGB, which is exactly our layout,
+    // so adopt its buffer instead of converting pixel by pixel
+    pixels_ = std::unique_ptr<Color[], BufferDeleter>(
+        reinterpret_cast<Color*>(data), [](Color* pixels) { stbi_image_free(pixels); });
+}
+
+Image::Image(int width, int height, Color* pixels, BufferDeleter deleter)
+    : width_(width), height_(height), pixels_(pixels, std::move(deleter)) {
+    if (width <= 0 || height <= 0 || !pixels) {
+        throw std::invalid_argument("Invalid image buffer");
     }
-    
-    stbi_image_free(data);
+}
+
+Image Image::mapPpm(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Failed to open image: " + filename);
+    }
+    int width = 0;
+    int height = 0;
+    readPpmHeader(file, filename, width, height);
+    return mapPixels(filename, static_cast<size_t>(file.tellg()), width, height);
+}
+
+Image Image::mapRaw(const std::string& filename, int width, int height) {
+    if (width <= 0 || height <= 0) {
+        throw std::invalid_argument("Invalid image dimensions");
+    }
+    return mapPixels(filename, 0, width, height);
+}
+
+Image Image::mapPixels(const std::string& filename, size_t offset, int width, int height) {
+    auto mapping = std::make_shared<MappedFile>(MappedFile::openRead(filename));
+    size_t bytes = static_cast<size_t>(width) * height * sizeof(Color);
+    if (mapping->size() < offset || mapping->size() - offset < bytes) {
+        throw std::runtime_error("Image file is truncated: " + filename);
+    }
+    // The deleter keeps the mapping alive for as long as the pixels are used
+    Color* pixels = reinterpret_cast<Color*>(mapping->data() + offset);
+    return Image(width, height, pixels, [mapping](Color*) mutable { mapping.reset(); });
+}
+
+Image::Image(const Image& other)
+    : width_(other.width_), height_(other.height_), pixels_(allocate(other.pixelCount())) {
+    std::copy(other.pixels_.get(), other.pixels_.get() + pixelCount(), pixels_.get());
+}
+
+Image& Image::operator=(const Image& other) {
+    if (this != &other) {
+        Image copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
 }
 
 Image::~Image() {
-    // Nothing special to clean up
+    // The buffer's deleter releases it (delete[], stbi_image_free, ...)
+}
+
+std::unique_ptr<Color[], Image::BufferDeleter> Image::allocate(size_t count) {
+    metrics::count(metrics::Counter::BYTES_ALLOCATED, count * sizeof(Color));
+    return std::unique_ptr<Color[], BufferDeleter>(new Color[count], [](Color* pixels) { delete[] pixels; });
+}
+
+Image Image::fromRgb(const uint8_t* rgb, int width, int height, size_t stride) {
+    size_t rowBytes = static_cast<size_t>(width) * sizeof(Color);
+    stride = stride == 0 ? rowBytes : stride;
+    Image image(width, height);
+    for (int y = 0; y < height; ++y) {
+        std::memcpy(image.row(y).data(), rgb + static_cast<size_t>(y) * stride, rowBytes);
+    }
+    return image;
 }
 
 Image Image::createSimilar() const {
     return Image(width_, height_);
 }
 
-bool Image::save(const std::string& filename) const {
-    // Convert our format to raw bytes
-    std::vector<unsigned char> data(width_ * height_ * 3);
-    for (int y = 0; y < height_; ++y) {
-        for (int x = 0; x < width_; ++x) {
-            Color color = getPixel(x, y);
-            int idx = (y * width_ + x) * 3;
-            data[idx] = color.r;
-            data[idx + 1] = color.g;
-            data[idx + 2] = color.b;
+Image Image::downsample() const {
+    Image half((width_ + 1) / 2, (height_ + 1) / 2);
+    for (int y = 0; y < half.height_; ++y) {
+        int y0 = y * 2;
+        int y1 = std::min(y0 + 1, height_ - 1);
+        for (int x = 0; x < half.width_; ++x) {
+            int x0 = x * 2;
+            int x1 = std::min(x0 + 1, width_ - 1);
+            const Color* block[4] = {&at(x0, y0), &at(x1, y0), &at(x0, y1), &at(x1, y1)};
+            int r = 0, g = 0, b = 0;
+            for (const Color* color : block) {
+                r += color->r;
+                g += color->g;
+                b += color->b;
+            }
+            half.at(x, y) = Color(static_cast<uint8_t>(r / 4), static_cast<uint8_t>(g / 4),
+                                  static_cast<uint8_t>(b / 4));
         }
     }
+    return half;
+}
+
+bool Image::save(const std::string& filename) const {
+    metrics::ScopedTimer timer(metrics::Phase::ENCODE);
+    
+    // Our buffer is already interleaved RGB; hand it to the writer as is
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(this->data());
     
     // Determine file format from extension
     std::string extension = filename.substr(filename.find_last_of(".") + 1);
     std::transform(extension.begin(), extension.end(), extension.begin(), 
                    [](unsigned char c) { return std::tolower(c); });
     
+    if (extension == "ppm") {
+        return saveMapped(filename, ppmHeader(width_, height_));
+    }
+    if (extension == "raw" || extension == "rgb") {
+        return saveMapped(filename, std::string());
+    }
+    
     int result = 0;
     if (extension == "png") {
-        result = stbi_write_png(filename.c_str(), width_, height_, 3, data.data(), width_ * 3);
+        result = stbi_write_png(filename.c_str(), width_, height_, 3, data, width_ * 3);
     } 
     else if (extension == "jpg" || extension == "jpeg") {
-        result = stbi_write_jpg(filename.c_str(), width_, height_, 3, data.data(), 90); // Quality 90
+        result = stbi_write_jpg(filename.c_str(), width_, height_, 3, data, 90); // Quality 90
     } 
     else if (extension == "bmp") {
-        result = stbi_write_bmp(filename.c_str(), width_, height_, 3, data.data());
+        result = stbi_write_bmp(filename.c_str(), width_, height_, 3, data);
     } 
     else {
         // Default to PNG
-        result = stbi_write_png(filename.c_str(), width_, height_, 3, data.data(), width_ * 3);
+        result = stbi_write_png(filename.c_str(), width_, height_, 3, data, width_ * 3);
+    }
+    
+    return result != 0;
+}
+
+namespace {
+
+// stb_image_write callback appending to a byte vector
+void appendBytes(void* context, void* data, int size) {
+    auto* out = static_cast<std::vector<uint8_t>*>(context);
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    out->insert(out->end(), bytes, bytes + size);
+}
+
+} // namespace
+
+bool Image::encode(const std::string& extension, std::vector<uint8_t>& out) const {
+    metrics::ScopedTimer timer(metrics::Phase::ENCODE);
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(this->data());
+    std::string format = extension.substr(extension.find_last_of(".") + 1);
+    std::transform(format.begin(), format.end(), format.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    out.clear();
+    
+    if (format == "ppm" || format == "raw" || format == "rgb") {
+        std::string header = format == "ppm" ? ppmHeader(width_, height_) : std::string();
+        out.reserve(header.size() + pixelCount() * sizeof(Color));
+        out.assign(header.begin(), header.end());
+        out.insert(out.end(), data, data + pixelCount() * sizeof(Color));
+        return true;
     }
     
+    int result = 0;
+    if (format == "png") {
+        result = stbi_write_png_to_func(appendBytes, &out, width_, height_, 3, data, width_ * 3);
+    }
+    else if (format == "jpg" || format == "jpeg") {
+        result = stbi_write_jpg_to_func(appendBytes, &out, width_, height_, 3, data, 90);
+    }
+    else if (format == "bmp") {
+        result = stbi_write_bmp_to_func(appendBytes, &out, width_, height_, 3, data);
+    }
     return result != 0;
 }
 
+bool Image::saveMapped(const std::string& filename, const std::string& header) const {
+    size_t bytes = pixelCount() * sizeof(Color);
+    try {
+        MappedFile file = MappedFile::create(filename, header.size() + bytes);
+        std::memcpy(file.data(), header.data(), header.size());
+        std::memcpy(file.data() + header.size(), data(), bytes);
+        return file.close();
+    }
+    catch (const std::exception&) {
+        return false;
+    }
+}
+
 Color Image::getPixel(int x, int y) const {
     if (x < 0 || x >= width_ || y < 0 || y >= height_) {
         return Color(); // Return black for out of bounds
@@ -101,16 +253,17 @@ Color Image::calculateAverageColor(const std::vector<Point>& points, const Image
         return Color();
     }
     
-    uint32_t totalR = 0, totalG = 0, totalB = 0;
+    // 64-bit sums: 32 bits overflow past ~16.8M pixels of 255
+    uint64_t totalR = 0, totalG = 0, totalB = 0;
     
     for (const auto& point : points) {
-        Color color = image.getPixel(point.x, point.y);
+        const Color& color = image.at(point.x, point.y);
         totalR += color.r;
         totalG += color.g;
         totalB += color.b;
     }
     
-    int count = static_cast<int>(points.size());
+    uint64_t count = points.size();
     return Color(
         static_cast<uint8_t>(totalR / count),
         static_cast<uint8_t>(totalG / count),
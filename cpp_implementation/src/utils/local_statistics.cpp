@@ -0,0 +1,65 @@
+#include "utils/local_statistics.hpp"
+#include "utils/metrics.hpp"
+#include <algorithm>
+
+namespace ic {
+
+LocalStatistics::LocalStatistics(const Image& image)
+    : width_(image.getWidth()), height_(image.getHeight()), stride_(static_cast<size_t>(width_) + 1) {
+    metrics::ScopedTimer timer(metrics::Phase::LOCAL_STATS);
+    size_t entries = stride_ * (static_cast<size_t>(height_) + 1);
+    metrics::count(metrics::Counter::BYTES_ALLOCATED, entries * (3 * sizeof(uint32_t) + sizeof(uint64_t)));
+    sums_.assign(entries * 3, 0);
+    squares_.assign(entries, 0);
+
+    // Row 0 and column 0 stay zero so queries need no edge cases
+    for (int y = 0; y < height_; ++y) {
+        Span<const Color> row = image.row(y);
+        uint32_t rowR = 0, rowG = 0, rowB = 0;
+        uint64_t rowSq = 0;
+        for (int x = 0; x < width_; ++x) {
+            const Color& c = row[x];
+            rowR += c.r;
+            rowG += c.g;
+            rowB += c.b;
+            rowSq += static_cast<uint64_t>(c.r * c.r + c.g * c.g + c.b * c.b);
+
+            size_t above = entry(x + 1, y);
+            size_t here = entry(x + 1, y + 1);
+            sums_[here * 3] = sums_[above * 3] + rowR;
+            sums_[here * 3 + 1] = sums_[above * 3 + 1] + rowG;
+            sums_[here * 3 + 2] = sums_[above * 3 + 2] + rowB;
+            squares_[here] = squares_[above] + rowSq;
+        }
+    }
+}
+
+double LocalStatistics::normalizedVariance(int x, int y, int radius) const {
+    radius = std::min(radius, kMaxRadius);
+    int xMin = std::max(0, x - radius);
+    int xMax = std::min(width_ - 1, x + radius);
+    int yMin = std::max(0, y - radius);
+    int yMax = std::min(height_ - 1, y + radius);
+
+    size_t a = entry(xMin, yMin);
+    size_t b = entry(xMax + 1, yMin);
+    size_t c = entry(xMin, yMax + 1);
+    size_t d = entry(xMax + 1, yMax + 1);
+
+    int64_t count = static_cast<int64_t>(xMax - xMin + 1) * (yMax - yMin + 1);
+    uint64_t sumSq = squares_[d] - squares_[b] - squares_[c] + squares_[a];
+
+    // sum((v - m)^2) = sumSq - 2*m*sum + count*m^2, per channel, with m the
+    // truncated mean used by the original per-pixel implementation
+    int64_t deviation = static_cast<int64_t>(sumSq);
+    for (int ch = 0; ch < 3; ++ch) {
+        int64_t sum = static_cast<uint32_t>(sums_[d * 3 + ch] - sums_[b * 3 + ch] - sums_[c * 3 + ch] +
+                                            sums_[a * 3 + ch]);
+        int64_t mean = sum / count;
+        deviation += count * mean * mean - 2 * mean * sum;
+    }
+
+    return static_cast<double>(deviation) / (static_cast<double>(count) * 3.0 * 255.0 * 255.0);
+}
+
+} // namespace ic
@@ -0,0 +1,178 @@
+#include "utils/mapped_file.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ic {
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0)),
+      writable_(other.writable_), path_(std::move(other.path_)) {
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+        writable_ = other.writable_;
+        path_ = std::move(other.path_);
+    }
+    return *this;
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+#ifdef _WIN32
+
+MappedFile MappedFile::openRead(const std::string& path) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        throw std::runtime_error("Failed to open file: " + path);
+    }
+    MappedFile mapped;
+    mapped.size_ = static_cast<size_t>(file.tellg());
+    mapped.data_ = new uint8_t[mapped.size_ > 0 ? mapped.size_ : 1];
+    mapped.path_ = path;
+    file.seekg(0);
+    if (!file.read(reinterpret_cast<char*>(mapped.data_), static_cast<std::streamsize>(mapped.size_))) {
+        throw std::runtime_error("Failed to read file: " + path);
+    }
+    return mapped;
+}
+
+MappedFile MappedFile::create(const std::string& path, size_t size) {
+    MappedFile mapped;
+    mapped.data_ = new uint8_t[size > 0 ? size : 1];
+    mapped.size_ = size;
+    mapped.writable_ = true;
+    mapped.path_ = path;
+    return mapped;
+}
+
+bool MappedFile::close() {
+    if (!data_) {
+        return true;
+    }
+    bool succeeded = true;
+    if (writable_) {
+        std::ofstream file(path_, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(data_), static_cast<std::streamsize>(size_));
+        succeeded = static_cast<bool>(file);
+    }
+    delete[] data_;
+    data_ = nullptr;
+    size_ = 0;
+    return succeeded;
+}
+
+#else
+
+namespace {
+
+// Allocate size bytes of disk for fd, so stores into a mapping of it can't
+// fail for lack of space
+bool reserve(int fd, size_t size) {
+#ifdef __APPLE__
+    // No posix_fallocate: write the zeros out instead
+    static const uint8_t zeros[64 * 1024] = {};
+    for (size_t offset = 0; offset < size;) {
+        size_t chunk = std::min(size - offset, sizeof(zeros));
+        ssize_t written = ::pwrite(fd, zeros, chunk, static_cast<off_t>(offset));
+        if (written <= 0) {
+            return false;
+        }
+        offset += static_cast<size_t>(written);
+    }
+    return true;
+#else
+    return ::posix_fallocate(fd, 0, static_cast<off_t>(size)) == 0;
+#endif
+}
+
+} // namespace
+
+MappedFile MappedFile::openRead(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open file: " + path);
+    }
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || info.st_size <= 0) {
+        ::close(fd);
+        throw std::runtime_error("Failed to map empty or unreadable file: " + path);
+    }
+
+    // Private and writable: pages are only copied if someone writes to them
+    size_t size = static_cast<size_t>(info.st_size);
+    void* address = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (address == MAP_FAILED) {
+        throw std::runtime_error("Failed to map file: " + path);
+    }
+    ::madvise(address, size, MADV_SEQUENTIAL);
+
+    MappedFile mapped;
+    mapped.data_ = static_cast<uint8_t*>(address);
+    mapped.size_ = size;
+    mapped.path_ = path;
+    return mapped;
+}
+
+MappedFile MappedFile::create(const std::string& path, size_t size) {
+    if (size == 0) {
+        throw std::invalid_argument("Cannot map an empty file: " + path);
+    }
+    int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to create file: " + path);
+    }
+    // Reserve the blocks up front: writing into a hole of a sparse file on
+    // a full disk raises SIGBUS instead of returning an error
+    if (!reserve(fd, size)) {
+        ::close(fd);
+        ::unlink(path.c_str());
+        throw std::runtime_error("Failed to reserve " + std::to_string(size) + " bytes for file: " + path);
+    }
+    void* address = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (address == MAP_FAILED) {
+        throw std::runtime_error("Failed to map file: " + path);
+    }
+
+    MappedFile mapped;
+    mapped.data_ = static_cast<uint8_t*>(address);
+    mapped.size_ = size;
+    mapped.writable_ = true;
+    mapped.path_ = path;
+    return mapped;
+}
+
+bool MappedFile::close() {
+    if (!data_) {
+        return true;
+    }
+    // Write a write mapping back before unmapping, so I/O errors surface
+    // here rather than being dropped by the kernel later
+    bool succeeded = !writable_ || ::msync(data_, size_, MS_SYNC) == 0;
+    succeeded = ::munmap(data_, size_) == 0 && succeeded;
+    data_ = nullptr;
+    size_ = 0;
+    return succeeded;
+}
+
+#endif
+
+} // namespace ic
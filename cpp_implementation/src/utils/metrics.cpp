@@ -0,0 +1,153 @@
+#include "utils/metrics.hpp"
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+namespace ic {
+namespace metrics {
+
+const char* phaseName(Phase phase) {
+    switch (phase) {
+        case Phase::DECODE: return "decode";
+        case Phase::LOCAL_STATS: return "local_stats";
+        case Phase::REGION_GROWTH: return "region_growth";
+        case Phase::AVERAGING: return "averaging";
+        case Phase::STITCHING: return "stitching";
+        case Phase::ENCODE: return "encode";
+        case Phase::PYRAMID: return "pyramid";
+        case Phase::MERGING: return "merging";
+        default: return "unknown";
+    }
+}
+
+const char* counterName(Counter counter) {
+    switch (counter) {
+        case Counter::QUEUE_PUSHES: return "queue_pushes";
+        case Counter::QUEUE_POPS: return "queue_pops";
+        case Counter::STALE_POPS: return "stale_pops";
+        case Counter::SIMILARITY_LOOKUPS: return "similarity_lookups";
+        case Counter::CACHE_HITS: return "cache_hits";
+        case Counter::CACHE_MISSES: return "cache_misses";
+        case Counter::ADAPTIVE_THRESHOLDS: return "adaptive_thresholds";
+        case Counter::BYTES_ALLOCATED: return "bytes_allocated";
+        default: return "unknown";
+    }
+}
+
+bool Snapshot::empty() const {
+    auto zero = [](uint64_t value) { return value == 0; };
+    return std::all_of(phaseCalls.begin(), phaseCalls.end(), zero) &&
+           std::all_of(counters.begin(), counters.end(), zero);
+}
+
+Snapshot& Snapshot::operator+=(const Snapshot& other) {
+    for (size_t i = 0; i < kPhaseCount; ++i) {
+        phaseNanos[i] += other.phaseNanos[i];
+        phaseCalls[i] += other.phaseCalls[i];
+    }
+    for (size_t i = 0; i < kCounterCount; ++i) {
+        counters[i] += other.counters[i];
+    }
+    return *this;
+}
+
+Snapshot Snapshot::operator-(const Snapshot& other) const {
+    Snapshot difference;
+    for (size_t i = 0; i < kPhaseCount; ++i) {
+        difference.phaseNanos[i] = phaseNanos[i] - other.phaseNanos[i];
+        difference.phaseCalls[i] = phaseCalls[i] - other.phaseCalls[i];
+    }
+    for (size_t i = 0; i < kCounterCount; ++i) {
+        difference.counters[i] = counters[i] - other.counters[i];
+    }
+    return difference;
+}
+
+void Snapshot::writeJson(std::ostream& out) const {
+    std::streamsize precision = out.precision(15);
+    out << "{\"phases\": {";
+    for (size_t i = 0; i < kPhaseCount; ++i) {
+        out << (i == 0 ? "" : ", ") << "\"" << phaseName(static_cast<Phase>(i)) << "\": {\"seconds\": "
+            << phaseNanos[i] * 1e-9 << ", \"calls\": " << phaseCalls[i] << "}";
+    }
+    out << "}, \"counters\": {";
+    for (size_t i = 0; i < kCounterCount; ++i) {
+        out << (i == 0 ? "" : ", ") << "\"" << counterName(static_cast<Counter>(i)) << "\": " << counters[i];
+    }
+    out << "}}";
+    out.precision(precision);
+}
+
+#if IC_ENABLE_METRICS
+
+namespace detail {
+
+namespace {
+
+// Live thread blocks plus the totals of threads that have exited. Leaked so
+// it outlives thread_local blocks destroyed during process exit.
+struct Registry {
+    std::mutex mutex;
+    std::vector<const ThreadBlock*> live;
+    Snapshot retired;
+};
+
+Registry& registry() {
+    static Registry* instance = new Registry();
+    return *instance;
+}
+
+} // namespace
+
+ThreadBlock::ThreadBlock() {
+    Registry& shared = registry();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    shared.live.push_back(this);
+}
+
+ThreadBlock::~ThreadBlock() {
+    Registry& shared = registry();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    shared.retired += snapshot();
+    shared.live.erase(std::remove(shared.live.begin(), shared.live.end(), this), shared.live.end());
+}
+
+Snapshot ThreadBlock::snapshot() const {
+    Snapshot result;
+    for (size_t i = 0; i < kPhaseCount; ++i) {
+        result.phaseNanos[i] = phaseNanos[i].load(std::memory_order_relaxed);
+        result.phaseCalls[i] = phaseCalls[i].load(std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < kCounterCount; ++i) {
+        result.counters[i] = counters[i].load(std::memory_order_relaxed);
+    }
+    return result;
+}
+
+ThreadBlock& threadBlock() {
+    thread_local ThreadBlock block;
+    return block;
+}
+
+} // namespace detail
+
+Snapshot collect() {
+    detail::Registry& shared = detail::registry();
+    std::lock_guard<std::mutex> lock(shared.mutex);
+    Snapshot total = shared.retired;
+    for (const detail::ThreadBlock* block : shared.live) {
+        total += block->snapshot();
+    }
+    return total;
+}
+
+#else
+
+Snapshot collect() {
+    return Snapshot();
+}
+
+#endif
+
+} // namespace metrics
+} // namespace ic
@@ -0,0 +1,82 @@
+#include "utils/progress.hpp"
+#include <algorithm>
+#include <iostream>
+
+namespace ic {
+
+void ProgressSample::writeJson(std::ostream& out) const {
+    std::streamsize precision = out.precision(6);
+    out << "{\"progress\": " << progress
+        << ", \"processed_pixels\": " << processedPixels
+        << ", \"total_pixels\": " << totalPixels
+        << ", \"regions\": " << regions
+        << ", \"elapsed\": " << elapsed
+        << ", \"rate\": " << rate
+        << ", \"remaining\": " << remaining
+        << ", \"finished\": " << (finished ? "true" : "false") << "}";
+    out.precision(precision);
+}
+
+ProgressSample ProgressCounters::sample() const {
+    ProgressSample sample;
+    sample.totalPixels = totalPixels_.load(std::memory_order_relaxed);
+    sample.processedPixels = processedPixels_.load(std::memory_order_relaxed);
+    sample.regions = regions_.load(std::memory_order_relaxed);
+    sample.elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+    sample.progress = sample.totalPixels > 0
+                    ? std::min(1.0, static_cast<double>(sample.processedPixels) / sample.totalPixels)
+                    : 0.0;
+    sample.rate = sample.elapsed > 0.0 ? sample.processedPixels / sample.elapsed : 0.0;
+    sample.remaining = sample.progress >= 1.0
+                     ? 0.0
+                     : sample.elapsed / std::max(0.001, sample.progress) - sample.elapsed;
+    return sample;
+}
+
+ProgressReporter::ProgressReporter(const ProgressCounters& counters, double intervalSeconds, ProgressSink sink)
+    : counters_(counters), interval_(std::max(0.001, intervalSeconds)), sink_(std::move(sink)) {
+    thread_ = std::thread(&ProgressReporter::run, this);
+}
+
+ProgressReporter::~ProgressReporter() {
+    stop();
+}
+
+void ProgressReporter::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_one();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void ProgressReporter::run() {
+    // A throwing sink must not take the job down with it
+    auto deliver = [this](const ProgressSample& sample) {
+        try {
+            sink_(sample);
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Error in progress callback: " << e.what() << std::endl;
+        }
+    };
+
+    // First sample right away, then one per interval until stopped
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        lock.unlock();
+        deliver(counters_.sample());
+        lock.lock();
+        wake_.wait_for(lock, interval_, [this] { return stopping_; });
+    }
+    lock.unlock();
+
+    ProgressSample last = counters_.sample();
+    last.finished = true;
+    deliver(last);
+}
+
+} // namespace ic
@@ -0,0 +1,141 @@
+#include "utils/rans_coder.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace ic {
+
+namespace {
+
+constexpr uint32_t kProbabilityBits = 12;
+constexpr uint32_t kProbabilityScale = 1u << kProbabilityBits;
+constexpr uint32_t kLowerBound = 1u << 23;   // state stays in [L, 256 * L)
+constexpr size_t kTableBytes = 256 * 2;
+
+// Scale byte counts to frequencies summing to kProbabilityScale, keeping
+// every symbol that occurs at a frequency of at least 1
+void normalizeFrequencies(const uint64_t counts[256], uint64_t total, uint32_t freqs[256]) {
+    uint32_t sum = 0;
+    for (int s = 0; s < 256; ++s) {
+        freqs[s] = counts[s] == 0 ? 0 : std::max<uint32_t>(1, static_cast<uint32_t>(counts[s] * kProbabilityScale / total));
+        sum += freqs[s];
+    }
+
+    // Settle rounding on the most frequent symbols, never dropping one to 0
+    while (sum != kProbabilityScale) {
+        int best = static_cast<int>(std::max_element(freqs, freqs + 256) - freqs);
+        if (sum < kProbabilityScale) {
+            freqs[best] += kProbabilityScale - sum;
+            sum = kProbabilityScale;
+        }
+        else {
+            int victim = -1;
+            for (int s = 0; s < 256; ++s) {
+                if (freqs[s] > 1 && (victim < 0 || freqs[s] > freqs[victim])) {
+                    victim = s;
+                }
+            }
+            uint32_t take = std::min(freqs[victim] - 1, sum - kProbabilityScale);
+            freqs[victim] -= take;
+            sum -= take;
+        }
+    }
+}
+
+} // namespace
+
+std::vector<uint8_t> ransEncode(const std::vector<uint8_t>& input) {
+    uint64_t counts[256] = {};
+    for (uint8_t byte : input) {
+        counts[byte]++;
+    }
+
+    uint32_t freqs[256] = {};
+    uint32_t starts[256] = {};
+    if (!input.empty()) {
+        normalizeFrequencies(counts, input.size(), freqs);
+        for (int s = 1; s < 256; ++s) {
+            starts[s] = starts[s - 1] + freqs[s - 1];
+        }
+    }
+
+    // rANS encodes back to front, so the bytes are produced reversed
+    std::vector<uint8_t> reversed;
+    reversed.reserve(input.size() / 2 + 16);
+    uint32_t state = kLowerBound;
+    for (size_t i = input.size(); i-- > 0;) {
+        uint32_t freq = freqs[input[i]];
+        uint32_t limit = ((kLowerBound >> kProbabilityBits) << 8) * freq;
+        while (state >= limit) {
+            reversed.push_back(static_cast<uint8_t>(state));
+            state >>= 8;
+        }
+        state = ((state / freq) << kProbabilityBits) + (state % freq) + starts[input[i]];
+    }
+    for (int i = 0; i < 4; ++i) {
+        reversed.push_back(static_cast<uint8_t>(state));
+        state >>= 8;
+    }
+
+    std::vector<uint8_t> output;
+    output.reserve(kTableBytes + reversed.size());
+    for (int s = 0; s < 256; ++s) {
+        output.push_back(static_cast<uint8_t>(freqs[s]));
+        output.push_back(static_cast<uint8_t>(freqs[s] >> 8));
+    }
+    output.insert(output.end(), reversed.rbegin(), reversed.rend());
+    return output;
+}
+
+std::vector<uint8_t> ransDecode(const uint8_t* data, size_t size, size_t outputSize) {
+    if (size < kTableBytes + 4) {
+        throw std::runtime_error("Truncated entropy-coded stream");
+    }
+
+    uint32_t freqs[256];
+    uint32_t starts[256];
+    uint32_t sum = 0;
+    for (int s = 0; s < 256; ++s) {
+        freqs[s] = data[2 * s] | static_cast<uint32_t>(data[2 * s + 1]) << 8;
+        starts[s] = sum;
+        sum += freqs[s];
+    }
+    // An empty input is encoded with an all-zero table; anything else must
+    // fill the table exactly, or the slot lookup below runs past its end
+    if (outputSize == 0) {
+        return std::vector<uint8_t>();
+    }
+    if (sum != kProbabilityScale) {
+        throw std::runtime_error("Invalid entropy coder frequency table");
+    }
+
+    // Slot -> symbol lookup
+    std::vector<uint8_t> symbolOf(kProbabilityScale, 0);
+    for (int s = 0; s < 256; ++s) {
+        std::fill(symbolOf.begin() + starts[s], symbolOf.begin() + starts[s] + freqs[s], static_cast<uint8_t>(s));
+    }
+
+    const uint8_t* in = data + kTableBytes;
+    const uint8_t* end = data + size;
+    uint32_t state = 0;
+    for (int i = 0; i < 4; ++i) {
+        state = state << 8 | in[i];
+    }
+    in += 4;
+
+    std::vector<uint8_t> output(outputSize);
+    for (size_t i = 0; i < outputSize; ++i) {
+        uint32_t slot = state & (kProbabilityScale - 1);
+        uint8_t symbol = symbolOf[slot];
+        output[i] = symbol;
+        state = freqs[symbol] * (state >> kProbabilityBits) + slot - starts[symbol];
+        while (state < kLowerBound) {
+            if (in == end) {
+                throw std::runtime_error("Truncated entropy-coded stream");
+            }
+            state = state << 8 | *in++;
+        }
+    }
+    return output;
+}
+
+} // namespace ic
@@ -0,0 +1,216 @@
+#include "utils/region_graph.hpp"
+#include "utils/metrics.hpp"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <numeric>
+
+namespace ic {
+
+namespace {
+
+float meanDelta(const RegionSums& a, const RegionSums& b) {
+    Color colorA = a.mean();
+    Color colorB = b.mean();
+    int dr = colorA.r - colorB.r;
+    int dg = colorA.g - colorB.g;
+    int db = colorA.b - colorB.b;
+    return std::sqrt(static_cast<float>(dr * dr + dg * dg + db * db));
+}
+
+bool fitsCap(const RegionGraph& graph, uint32_t rootA, uint32_t rootB, int maxRegionSize) {
+    uint64_t combined = static_cast<uint64_t>(graph.sums(rootA).count) + graph.sums(rootB).count;
+    return maxRegionSize <= 0 || combined <= static_cast<uint64_t>(maxRegionSize);
+}
+
+} // namespace
+
+RegionGraph::RegionGraph(const LabelMap& labels, const Image& image, size_t regionCount)
+    : sums_(regionCount), sets_(regionCount), liveRegions_(regionCount), offsets_(regionCount + 1, 0),
+      nextMember_(regionCount, kEnd), lastMember_(regionCount) {
+    std::iota(lastMember_.begin(), lastMember_.end(), 0u);
+    const uint32_t* ids = labels.data();
+    const Color* pixels = image.data();
+    for (size_t i = 0; i < labels.size(); ++i) {
+        sums_[ids[i]].add(pixels[i]);
+    }
+
+    // Every differing pair of 4-neighbors as (low id, high id); after
+    // sorting, the length of each run is the boundary length
+    std::vector<uint64_t> pairs;
+    auto addPair = [&pairs](uint32_t a, uint32_t b) {
+        if (a != b) {
+            pairs.push_back(a < b ? (static_cast<uint64_t>(a) << 32) | b : (static_cast<uint64_t>(b) << 32) | a);
+        }
+    };
+    int width = labels.getWidth();
+    int height = labels.getHeight();
+    for (int y = 0; y < height; ++y) {
+        const uint32_t* row = ids + labels.index(0, y);
+        for (int x = 0; x + 1 < width; ++x) {
+            addPair(row[x], row[x + 1]);
+        }
+        if (y + 1 < height) {
+            const uint32_t* below = row + width;
+            for (int x = 0; x < width; ++x) {
+                addPair(row[x], below[x]);
+            }
+        }
+    }
+    std::sort(pairs.begin(), pairs.end());
+
+    // Degrees, then offsets, then both directions of every run
+    for (size_t i = 0; i < pairs.size(); ++i) {
+        if (i == 0 || pairs[i] != pairs[i - 1]) {
+            ++offsets_[(pairs[i] >> 32) + 1];
+            ++offsets_[static_cast<uint32_t>(pairs[i]) + 1];
+        }
+    }
+    for (size_t id = 0; id < regionCount; ++id) {
+        offsets_[id + 1] += offsets_[id];
+    }
+    std::vector<uint32_t> fill(offsets_.begin(), offsets_.end() - 1);
+    edges_.resize(offsets_[regionCount]);
+    for (size_t i = 0; i < pairs.size();) {
+        size_t end = i + 1;
+        while (end < pairs.size() && pairs[end] == pairs[i]) {
+            ++end;
+        }
+        uint32_t a = static_cast<uint32_t>(pairs[i] >> 32);
+        uint32_t b = static_cast<uint32_t>(pairs[i]);
+        uint32_t boundary = static_cast<uint32_t>(end - i);
+        float delta = meanDelta(sums_[a], sums_[b]);
+        edges_[fill[a]++] = RegionEdge{b, boundary, delta};
+        edges_[fill[b]++] = RegionEdge{a, boundary, delta};
+        i = end;
+    }
+    metrics::count(metrics::Counter::BYTES_ALLOCATED, edges_.size() * sizeof(RegionEdge));
+}
+
+float RegionGraph::colorDelta(uint32_t rootA, uint32_t rootB) const {
+    return meanDelta(sums_[rootA], sums_[rootB]);
+}
+
+uint32_t RegionGraph::merge(uint32_t rootA, uint32_t rootB) {
+    uint32_t root = sets_.unite(rootA, rootB);
+    uint32_t absorbed = root == rootA ? rootB : rootA;
+    sums_[root].merge(sums_[absorbed]);
+    nextMember_[lastMember_[root]] = absorbed;
+    lastMember_[root] = lastMember_[absorbed];
+    --liveRegions_;
+    return root;
+}
+
+std::vector<uint32_t> RegionGraph::compact(std::vector<Color>& colors, std::vector<int>& sizes) {
+    std::vector<uint32_t> finalId(sums_.size(), LabelMap::kUnassigned);
+    for (uint32_t id = 0; id < sums_.size(); ++id) {
+        uint32_t root = sets_.find(id);
+        if (sums_[root].count == 0) {
+            continue;
+        }
+        if (finalId[root] == LabelMap::kUnassigned) {
+            finalId[root] = static_cast<uint32_t>(colors.size());
+            colors.push_back(sums_[root].mean());
+            sizes.push_back(static_cast<int>(sums_[root].count));
+        }
+        finalId[id] = finalId[root];
+    }
+    return finalId;
+}
+
+int mergeSmallRegions(RegionGraph& graph, uint32_t minSize, int maxRegionSize) {
+    // Smallest first, so slivers fold into real regions rather than into
+    // each other
+    std::vector<uint32_t> small;
+    for (uint32_t id = 0; id < graph.regionCount(); ++id) {
+        if (graph.sums(id).count < minSize) {
+            small.push_back(id);
+        }
+    }
+    std::stable_sort(small.begin(), small.end(),
+                     [&](uint32_t a, uint32_t b) { return graph.sums(a).count < graph.sums(b).count; });
+
+    int merged = 0;
+    for (uint32_t id : small) {
+        uint32_t root = graph.find(id);
+        if (graph.sums(root).count >= minSize) {
+            continue;
+        }
+        uint32_t best = root;
+        float bestDelta = std::numeric_limits<float>::max();
+        graph.forEachNeighbor(root, [&](uint32_t other, const RegionEdge&) {
+            if (!fitsCap(graph, root, other, maxRegionSize)) {
+                return;
+            }
+            float delta = graph.colorDelta(root, other);
+            if (delta < bestDelta) {
+                bestDelta = delta;
+                best = other;
+            }
+        });
+        if (best != root) {
+            graph.merge(root, best);
+            ++merged;
+        }
+    }
+    return merged;
+}
+
+namespace {
+
+// Heap entry for one adjacency, between the sets of two original ids
+struct MergeCandidate {
+    float delta;
+    uint32_t a, b;
+
+    bool operator>(const MergeCandidate& other) const { return delta > other.delta; }
+};
+
+} // namespace
+
+int mergeToTarget(RegionGraph& graph, const MergeTarget& target, int maxRegionSize) {
+    std::vector<MergeCandidate> heap;
+    heap.reserve(graph.edgeCount() / 2);
+    for (uint32_t id = 0; id < graph.regionCount(); ++id) {
+        for (const RegionEdge& edge : graph.edges(id)) {
+            if (edge.target > id) {
+                heap.push_back(MergeCandidate{edge.colorDelta, id, edge.target});
+            }
+        }
+    }
+    std::greater<MergeCandidate> later;
+    std::make_heap(heap.begin(), heap.end(), later);
+
+    int merged = 0;
+    while (!heap.empty() && (target.regionCount == 0 || graph.liveRegions() > target.regionCount)) {
+        std::pop_heap(heap.begin(), heap.end(), later);
+        MergeCandidate candidate = heap.back();
+        heap.pop_back();
+        uint32_t rootA = graph.find(candidate.a);
+        uint32_t rootB = graph.find(candidate.b);
+        if (rootA == rootB) {
+            continue;
+        }
+        // Means move when regions merge: a pair that got further apart waits
+        // its turn again. (One that got closer is merged a little late.)
+        float delta = graph.colorDelta(rootA, rootB);
+        if (delta > candidate.delta) {
+            heap.push_back(MergeCandidate{delta, candidate.a, candidate.b});
+            std::push_heap(heap.begin(), heap.end(), later);
+            continue;
+        }
+        if (target.maxColorDelta > 0.0 && delta > target.maxColorDelta) {
+            break;
+        }
+        // Regions only grow, so a pair over the cap stays over it
+        if (!fitsCap(graph, rootA, rootB, maxRegionSize)) {
+            continue;
+        }
+        graph.merge(rootA, rootB);
+        ++merged;
+    }
+    return merged;
+}
+
+} // namespace ic
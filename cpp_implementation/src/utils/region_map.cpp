@@ -0,0 +1,263 @@
+#include "utils/region_map.hpp"
+#include "utils/metrics.hpp"
+#include "utils/rans_coder.hpp"
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+namespace ic {
+
+// File layout (little-endian):
+//   "ICRM", u8 version, u8 flags, u16 reserved,
+//   u32 width, u32 height, u32 region count,
+//   u32 stored payload size, u32 raw payload size,
+//   region count * 3 bytes of RGB palette, payload.
+// The raw payload holds, row by row, one entry per run of equal labels:
+//   varint(run length - 1), varint(label code)
+// where label code 0 = the label above the run's first pixel, 1 = the next
+// label not seen yet, and n >= 2 = label n - 2. Labels are renumbered in
+// raster order of first appearance, so new regions always take code 1.
+
+namespace {
+
+constexpr char kMagic[4] = {'I', 'C', 'R', 'M'};
+constexpr uint8_t kVersion = 1;
+constexpr uint8_t kFlagEntropyCoded = 1;
+constexpr size_t kHeaderSize = 28;
+constexpr uint64_t kMaxVarintBytes = 5;    // a uint32_t in 7-bit groups
+
+constexpr uint32_t kCodeAbove = 0;
+constexpr uint32_t kCodeNew = 1;
+constexpr uint32_t kCodeExplicit = 2;
+
+void putU32(std::vector<uint8_t>& out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+uint32_t getU32(const uint8_t* in) {
+    return in[0] | in[1] << 8 | in[2] << 16 | static_cast<uint32_t>(in[3]) << 24;
+}
+
+void putVarint(std::vector<uint8_t>& out, uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+// Reads a varint, advancing pos; throws past the end of the buffer
+uint32_t getVarint(const std::vector<uint8_t>& in, size_t& pos) {
+    uint32_t value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (pos >= in.size()) {
+            throw std::runtime_error("Truncated region map");
+        }
+        uint8_t byte = in[pos++];
+        value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return value;
+        }
+    }
+    throw std::runtime_error("Malformed varint in region map");
+}
+
+} // namespace
+
+RegionMap::RegionMap(LabelMap labels, std::vector<Color> palette)
+    : labels_(std::move(labels)), palette_(std::move(palette)) {
+}
+
+bool RegionMap::isRegionMapPath(const std::string& path) {
+    std::string extension = std::filesystem::path(path).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    return extension == kExtension;
+}
+
+std::vector<uint8_t> RegionMap::encode(bool entropyCoded) const {
+    int width = labels_.getWidth();
+    int height = labels_.getHeight();
+
+    // Renumber regions in raster order of first appearance
+    std::vector<uint32_t> canonical(palette_.size(), LabelMap::kUnassigned);
+    std::vector<Color> palette;
+    palette.reserve(palette_.size());
+    for (size_t i = 0; i < labels_.size(); ++i) {
+        uint32_t label = labels_[i];
+        if (canonical[label] == LabelMap::kUnassigned) {
+            canonical[label] = static_cast<uint32_t>(palette.size());
+            palette.push_back(palette_[label]);
+        }
+    }
+
+    std::vector<uint8_t> payload;
+    uint32_t nextNew = 0;
+    for (int y = 0; y < height; ++y) {
+        const uint32_t* row = labels_.data() + labels_.index(0, y);
+        const uint32_t* above = y > 0 ? row - width : nullptr;
+        for (int x = 0; x < width;) {
+            uint32_t label = canonical[row[x]];
+            int end = x + 1;
+            while (end < width && row[end] == row[x]) {
+                ++end;
+            }
+            putVarint(payload, static_cast<uint32_t>(end - x - 1));
+
+            if (above && canonical[above[x]] == label) {
+                putVarint(payload, kCodeAbove);
+            }
+            else if (label == nextNew) {
+                putVarint(payload, kCodeNew);
+                ++nextNew;
+            }
+            else {
+                putVarint(payload, label + kCodeExplicit);
+            }
+            x = end;
+        }
+    }
+
+    uint8_t flags = 0;
+    std::vector<uint8_t> stored;
+    if (entropyCoded) {
+        stored = ransEncode(payload);
+        if (stored.size() < payload.size()) {
+            flags |= kFlagEntropyCoded;
+        }
+    }
+    if ((flags & kFlagEntropyCoded) == 0) {
+        stored = std::move(payload);
+    }
+
+    std::vector<uint8_t> out(kMagic, kMagic + 4);
+    out.push_back(kVersion);
+    out.push_back(flags);
+    out.push_back(0);
+    out.push_back(0);
+    putU32(out, static_cast<uint32_t>(width));
+    putU32(out, static_cast<uint32_t>(height));
+    putU32(out, static_cast<uint32_t>(palette.size()));
+    putU32(out, static_cast<uint32_t>(stored.size()));
+    putU32(out, static_cast<uint32_t>(flags & kFlagEntropyCoded ? payload.size() : stored.size()));
+    for (const Color& color : palette) {
+        out.push_back(color.r);
+        out.push_back(color.g);
+        out.push_back(color.b);
+    }
+    out.insert(out.end(), stored.begin(), stored.end());
+    return out;
+}
+
+RegionMap RegionMap::decode(const std::vector<uint8_t>& bytes) {
+    if (bytes.size() < kHeaderSize || !std::equal(kMagic, kMagic + 4, bytes.begin())) {
+        throw std::runtime_error("Not a region map");
+    }
+    if (bytes[4] != kVersion) {
+        throw std::runtime_error("Unsupported region map version");
+    }
+
+    uint8_t flags = bytes[5];
+    uint32_t width = getU32(&bytes[8]);
+    uint32_t height = getU32(&bytes[12]);
+    uint32_t regions = getU32(&bytes[16]);
+    uint32_t storedSize = getU32(&bytes[20]);
+    uint32_t rawSize = getU32(&bytes[24]);
+    if (width == 0 || height == 0 || width > 0x7FFFFFFF || height > 0x7FFFFFFF ||
+        bytes.size() != kHeaderSize + static_cast<uint64_t>(regions) * 3 + storedSize) {
+        throw std::runtime_error("Corrupt region map header");
+    }
+
+    // Each run is two varints of 1 to kMaxVarintBytes bytes, at least one
+    // run per row and at most one per pixel, so rawSize is bounded before
+    // the entropy decoder allocates it
+    uint64_t pixels = static_cast<uint64_t>(width) * height;
+    bool entropyCoded = (flags & kFlagEntropyCoded) != 0;
+    if (rawSize < 2ull * height || rawSize > 2ull * kMaxVarintBytes * pixels ||
+        (!entropyCoded && rawSize != storedSize)) {
+        throw std::runtime_error("Corrupt region map payload size");
+    }
+
+    std::vector<Color> palette(regions);
+    const uint8_t* colors = &bytes[kHeaderSize];
+    for (uint32_t i = 0; i < regions; ++i) {
+        palette[i] = Color(colors[3 * i], colors[3 * i + 1], colors[3 * i + 2]);
+    }
+
+    const uint8_t* stored = colors + static_cast<size_t>(regions) * 3;
+    std::vector<uint8_t> payload = entropyCoded
+                                 ? ransDecode(stored, storedSize, rawSize)
+                                 : std::vector<uint8_t>(stored, stored + storedSize);
+
+    LabelMap labels(static_cast<int>(width), static_cast<int>(height));
+    uint32_t nextNew = 0;
+    size_t pos = 0;
+    for (uint32_t y = 0; y < height; ++y) {
+        uint32_t* row = labels.data() + labels.index(0, static_cast<int>(y));
+        for (uint32_t x = 0; x < width;) {
+            uint32_t length = getVarint(payload, pos) + 1;
+            uint32_t code = getVarint(payload, pos);
+            if (length > width - x) {
+                throw std::runtime_error("Region map run overflows its row");
+            }
+
+            uint32_t label;
+            if (code == kCodeAbove) {
+                if (y == 0) {
+                    throw std::runtime_error("Region map references a row above the first");
+                }
+                label = (row - width)[x];
+            }
+            else if (code == kCodeNew) {
+                label = nextNew++;
+            }
+            else {
+                label = code - kCodeExplicit;
+            }
+            if (label >= regions) {
+                throw std::runtime_error("Region map label out of range");
+            }
+
+            std::fill(row + x, row + x + length, label);
+            x += length;
+        }
+    }
+
+    return RegionMap(std::move(labels), std::move(palette));
+}
+
+bool RegionMap::save(const std::string& path, bool entropyCoded) const {
+    metrics::ScopedTimer timer(metrics::Phase::ENCODE);
+    std::vector<uint8_t> bytes = encode(entropyCoded);
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    return static_cast<bool>(file);
+}
+
+RegionMap RegionMap::load(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Failed to open region map: " + path);
+    }
+    std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    return decode(bytes);
+}
+
+Image RegionMap::render() const {
+    Image image(getWidth(), getHeight());
+    Color* pixels = image.data();
+    for (size_t i = 0; i < labels_.size(); ++i) {
+        pixels[i] = palette_[labels_[i]];
+    }
+    return image;
+}
+
+} // namespace ic
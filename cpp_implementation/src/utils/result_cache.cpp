@@ -0,0 +1,165 @@
+#include "utils/result_cache.hpp"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace ic {
+
+namespace {
+
+constexpr uint64_t kPrime1 = 0x9E3779B185EBCA87ull;
+constexpr uint64_t kPrime2 = 0xC2B2AE3D27D4EB4Full;
+constexpr uint64_t kPrime3 = 0x165667B19E3779F9ull;
+
+uint64_t rotl(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+uint64_t mixWord(uint64_t lane, uint64_t word) {
+    return rotl(lane + word * kPrime2, 31) * kPrime1;
+}
+
+uint64_t readWord(const uint8_t* bytes) {
+    uint64_t word;
+    std::memcpy(&word, bytes, sizeof(word));
+    return word;
+}
+
+} // namespace
+
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    const uint8_t* end = bytes + size;
+
+    // xxHash64-style: independent lanes keep several multiplies in flight
+    uint64_t lanes[4] = {seed + kPrime1 + kPrime2, seed + kPrime2, seed, seed - kPrime1};
+    for (; end - bytes >= 32; bytes += 32) {
+        lanes[0] = mixWord(lanes[0], readWord(bytes));
+        lanes[1] = mixWord(lanes[1], readWord(bytes + 8));
+        lanes[2] = mixWord(lanes[2], readWord(bytes + 16));
+        lanes[3] = mixWord(lanes[3], readWord(bytes + 24));
+    }
+    uint64_t hash = rotl(lanes[0], 1) + rotl(lanes[1], 7) + rotl(lanes[2], 12) + rotl(lanes[3], 18);
+    hash += static_cast<uint64_t>(size);
+
+    for (; end - bytes >= 8; bytes += 8) {
+        hash = rotl(hash ^ mixWord(0, readWord(bytes)), 27) * kPrime1 + kPrime3;
+    }
+    for (; bytes < end; ++bytes) {
+        hash = rotl(hash ^ (*bytes * kPrime3), 11) * kPrime1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= kPrime2;
+    hash ^= hash >> 29;
+    hash *= kPrime3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+ResultCache::ResultCache(std::string directory, uint64_t maxBytes)
+    : directory_(std::move(directory)), maxBytes_(maxBytes) {
+    std::error_code error;
+    std::filesystem::create_directories(directory_, error);
+    if (!std::filesystem::is_directory(directory_, error)) {
+        throw std::runtime_error("Cannot create result cache directory: " + directory_);
+    }
+}
+
+uint64_t ResultCache::hashImage(const Image& image) {
+    int dimensions[2] = {image.getWidth(), image.getHeight()};
+    uint64_t seed = hashBytes(dimensions, sizeof(dimensions));
+    return hashBytes(image.data(), image.getPixelCount() * sizeof(Color), seed);
+}
+
+std::string ResultCache::pathFor(const Key& key) const {
+    std::ostringstream name;
+    name << std::hex << std::setfill('0') << std::setw(16) << key.content << "-"
+         << std::setw(16) << key.parameters << RegionMap::kExtension;
+    return (std::filesystem::path(directory_) / name.str()).string();
+}
+
+bool ResultCache::load(const Key& key, RegionMap& result) {
+    std::string path = pathFor(key);
+    std::error_code error;
+    if (!std::filesystem::exists(path, error)) {
+        return false;
+    }
+    try {
+        result = RegionMap::load(path);
+    }
+    catch (const std::exception&) {
+        std::filesystem::remove(path, error);
+        return false;
+    }
+
+    // Most recently used now
+    std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), error);
+    return true;
+}
+
+void ResultCache::store(const Key& key, const RegionMap& result, bool entropyCoded) {
+    std::string path = pathFor(key);
+
+    // Written aside and renamed, so a reader never sees half an entry
+    std::ostringstream temporary;
+    temporary << path << "." << std::hash<std::thread::id>()(std::this_thread::get_id()) << ".tmp";
+    std::error_code error;
+    if (!result.save(temporary.str(), entropyCoded)) {
+        std::filesystem::remove(temporary.str(), error);
+        return;
+    }
+    std::filesystem::rename(temporary.str(), path, error);
+    if (error) {
+        std::filesystem::remove(temporary.str(), error);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    evict();
+}
+
+void ResultCache::evict() {
+    struct Entry {
+        std::filesystem::file_time_type used;
+        uint64_t bytes;
+        std::filesystem::path path;
+    };
+    std::vector<Entry> entries;
+    uint64_t total = 0;
+
+    std::error_code error;
+    for (const auto& file : std::filesystem::directory_iterator(directory_, error)) {
+        if (!file.is_regular_file(error) || file.path().extension() != RegionMap::kExtension) {
+            continue;
+        }
+        Entry entry{file.last_write_time(error), file.file_size(error), file.path()};
+        if (!error) {
+            total += entry.bytes;
+            entries.push_back(std::move(entry));
+        }
+    }
+    if (total <= maxBytes_) {
+        return;
+    }
+
+    // Least recently used first
+    std::sort(entries.begin(), entries.end(),
+              [](const Entry& a, const Entry& b) { return a.used < b.used; });
+    for (const Entry& entry : entries) {
+        if (total <= maxBytes_) {
+            break;
+        }
+        if (std::filesystem::remove(entry.path, error)) {
+            total -= entry.bytes;
+        }
+    }
+}
+
+} // namespace ic
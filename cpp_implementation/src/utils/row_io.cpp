@@ -0,0 +1,131 @@
+#include "utils/row_io.hpp"
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <stdexcept>
+
+namespace ic {
+
+namespace {
+
+// Next whitespace-separated header token, skipping # comments
+std::string readToken(std::istream& in) {
+    std::string token;
+    int c = in.get();
+    while (c != EOF) {
+        if (c == '#') {
+            while (c != EOF && c != '\n') {
+                c = in.get();
+            }
+        }
+        else if (std::isspace(c)) {
+            if (!token.empty()) {
+                break;
+            }
+        }
+        else {
+            token.push_back(static_cast<char>(c));
+        }
+        c = in.get();
+    }
+    return token;
+}
+
+int parseDimension(const std::string& token, const std::string& path) {
+    try {
+        int value = std::stoi(token);
+        if (value > 0) {
+            return value;
+        }
+    }
+    catch (const std::exception&) {
+    }
+    throw std::runtime_error("Invalid PPM header: " + path);
+}
+
+} // namespace
+
+std::string ppmHeader(int width, int height) {
+    return "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+}
+
+bool isRawPath(const std::string& path) {
+    std::string extension = std::filesystem::path(path).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    return extension == ".raw" || extension == ".rgb";
+}
+
+void readPpmHeader(std::istream& in, const std::string& path, int& width, int& height) {
+    if (readToken(in) != "P6") {
+        throw std::runtime_error("Not a binary PPM (P6) file: " + path);
+    }
+    width = parseDimension(readToken(in), path);
+    height = parseDimension(readToken(in), path);
+    if (readToken(in) != "255") {
+        throw std::runtime_error("Only 8-bit PPM files are supported: " + path);
+    }
+    // readToken consumed the single whitespace byte that ends the header
+}
+
+bool isPpmPath(const std::string& path) {
+    std::string extension = std::filesystem::path(path).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    return extension == ".ppm";
+}
+
+RowReader::RowReader(const std::string& path)
+    : file_(path, std::ios::binary), path_(path) {
+    if (!file_) {
+        throw std::runtime_error("Failed to open image: " + path);
+    }
+    readPpmHeader(file_, path, width_, height_);
+}
+
+RowReader::RowReader(const std::string& path, int width, int height)
+    : file_(path, std::ios::binary), path_(path), width_(width), height_(height) {
+    if (!file_) {
+        throw std::runtime_error("Failed to open image: " + path);
+    }
+    if (width <= 0 || height <= 0) {
+        throw std::invalid_argument("Invalid raw image dimensions");
+    }
+}
+
+int RowReader::readRows(Color* buffer, int count) {
+    int rows = std::min(count, height_ - rowsRead_);
+    if (rows <= 0) {
+        return 0;
+    }
+    std::streamsize bytes = static_cast<std::streamsize>(rows) * width_ * sizeof(Color);
+    file_.read(reinterpret_cast<char*>(buffer), bytes);
+    if (file_.gcount() != bytes) {
+        throw std::runtime_error("Unexpected end of image data: " + path_);
+    }
+    rowsRead_ += rows;
+    return rows;
+}
+
+RowWriter::RowWriter(const std::string& path, int width, int height)
+    : file_(path, std::ios::binary), width_(width) {
+    if (!file_) {
+        throw std::runtime_error("Failed to create image: " + path);
+    }
+    if (!isRawPath(path)) {
+        file_ << ppmHeader(width, height);
+    }
+}
+
+bool RowWriter::writeRows(const Color* rows, int count) {
+    file_.write(reinterpret_cast<const char*>(rows),
+                static_cast<std::streamsize>(count) * width_ * sizeof(Color));
+    return static_cast<bool>(file_);
+}
+
+bool RowWriter::close() {
+    file_.close();
+    return !file_.fail();
+}
+
+} // namespace ic
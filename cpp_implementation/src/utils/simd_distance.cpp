@@ -0,0 +1,207 @@
+#include "utils/simd_distance.hpp"
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define IC_SIMD_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define IC_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+// GCC and Clang need the ISA enabled per function; MSVC accepts intrinsics anywhere
+#if defined(IC_SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+#define IC_TARGET(isa) __attribute__((target(isa)))
+#else
+#define IC_TARGET(isa)
+#endif
+
+namespace ic {
+
+const char* simdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::SCALAR: return "scalar";
+        case SimdLevel::SSE4: return "sse4.1";
+        case SimdLevel::AVX2: return "avx2";
+        case SimdLevel::NEON: return "neon";
+        default: return "unknown";
+    }
+}
+
+namespace {
+
+void bestSquaredDistanceScalar(const Color& a, const Color& b, const ColorBatch& batch, int32_t* best) {
+    for (int i = 0; i < ColorBatch::kLanes; ++i) {
+        int32_t ar = batch.r[i] - a.r, ag = batch.g[i] - a.g, ab = batch.b[i] - a.b;
+        int32_t br = batch.r[i] - b.r, bg = batch.g[i] - b.g, bb = batch.b[i] - b.b;
+        best[i] = std::min(ar * ar + ag * ag + ab * ab, br * br + bg * bg + bb * bb);
+    }
+}
+
+#ifdef IC_SIMD_X86
+
+// Squared distances of 4 lanes held as 16-bit deltas: pairing (dr, dg) lets
+// madd produce dr^2 + dg^2 per 32-bit lane, and (db, 0) adds db^2
+IC_TARGET("sse4.1")
+inline __m128i sumSquares4(__m128i dr, __m128i dg, __m128i db, bool high) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i rg = high ? _mm_unpackhi_epi16(dr, dg) : _mm_unpacklo_epi16(dr, dg);
+    __m128i bz = high ? _mm_unpackhi_epi16(db, zero) : _mm_unpacklo_epi16(db, zero);
+    return _mm_add_epi32(_mm_madd_epi16(rg, rg), _mm_madd_epi16(bz, bz));
+}
+
+IC_TARGET("sse4.1")
+void bestSquaredDistanceSse4(const Color& a, const Color& b, const ColorBatch& batch, int32_t* best) {
+    __m128i r = _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(batch.r)));
+    __m128i g = _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(batch.g)));
+    __m128i bl = _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(batch.b)));
+
+    __m128i adr = _mm_sub_epi16(r, _mm_set1_epi16(a.r));
+    __m128i adg = _mm_sub_epi16(g, _mm_set1_epi16(a.g));
+    __m128i adb = _mm_sub_epi16(bl, _mm_set1_epi16(a.b));
+    __m128i bdr = _mm_sub_epi16(r, _mm_set1_epi16(b.r));
+    __m128i bdg = _mm_sub_epi16(g, _mm_set1_epi16(b.g));
+    __m128i bdb = _mm_sub_epi16(bl, _mm_set1_epi16(b.b));
+
+    __m128i low = _mm_min_epi32(sumSquares4(adr, adg, adb, false), sumSquares4(bdr, bdg, bdb, false));
+    __m128i high = _mm_min_epi32(sumSquares4(adr, adg, adb, true), sumSquares4(bdr, bdg, bdb, true));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(best), low);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(best + 4), high);
+}
+
+// 8 lanes widened to 16 bits and broadcast to both 128-bit halves
+IC_TARGET("avx2")
+inline __m256i broadcastLanes(const uint8_t* channel) {
+    __m128i wide = _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(channel)));
+    return _mm256_broadcastsi128_si256(wide);
+}
+
+// One channel of both references: a in the low half, b in the high half
+IC_TARGET("avx2")
+inline __m256i referenceLanes(uint8_t fromA, uint8_t fromB) {
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_set1_epi16(fromA)), _mm_set1_epi16(fromB), 1);
+}
+
+// Both references in one pass: the low half is measured against a and the
+// high half against b, then the halves are folded with a min
+IC_TARGET("avx2")
+void bestSquaredDistanceAvx2(const Color& a, const Color& b, const ColorBatch& batch, int32_t* best) {
+    __m256i dr = _mm256_sub_epi16(broadcastLanes(batch.r), referenceLanes(a.r, b.r));
+    __m256i dg = _mm256_sub_epi16(broadcastLanes(batch.g), referenceLanes(a.g, b.g));
+    __m256i db = _mm256_sub_epi16(broadcastLanes(batch.b), referenceLanes(a.b, b.b));
+    __m256i zero = _mm256_setzero_si256();
+
+    // unpack works within each half: [a lanes 0-3 | b lanes 0-3] and 4-7
+    __m256i rgLow = _mm256_unpacklo_epi16(dr, dg);
+    __m256i rgHigh = _mm256_unpackhi_epi16(dr, dg);
+    __m256i bzLow = _mm256_unpacklo_epi16(db, zero);
+    __m256i bzHigh = _mm256_unpackhi_epi16(db, zero);
+    __m256i low = _mm256_add_epi32(_mm256_madd_epi16(rgLow, rgLow), _mm256_madd_epi16(bzLow, bzLow));
+    __m256i high = _mm256_add_epi32(_mm256_madd_epi16(rgHigh, rgHigh), _mm256_madd_epi16(bzHigh, bzHigh));
+
+    __m128i bestLow = _mm_min_epi32(_mm256_castsi256_si128(low), _mm256_extracti128_si256(low, 1));
+    __m128i bestHigh = _mm_min_epi32(_mm256_castsi256_si128(high), _mm256_extracti128_si256(high, 1));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(best), bestLow);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(best + 4), bestHigh);
+}
+
+#endif
+
+#ifdef IC_SIMD_NEON
+
+// |delta| fits in 8 bits and its square in 16, so widen only for the sum
+void bestSquaredDistanceNeon(const Color& a, const Color& b, const ColorBatch& batch, int32_t* best) {
+    uint8x8_t r = vld1_u8(batch.r);
+    uint8x8_t g = vld1_u8(batch.g);
+    uint8x8_t bl = vld1_u8(batch.b);
+
+    auto squared = [&](const Color& reference, bool high) {
+        uint8x8_t dr = vabd_u8(r, vdup_n_u8(reference.r));
+        uint8x8_t dg = vabd_u8(g, vdup_n_u8(reference.g));
+        uint8x8_t db = vabd_u8(bl, vdup_n_u8(reference.b));
+        uint16x8_t sr = vmull_u8(dr, dr);
+        uint16x8_t sg = vmull_u8(dg, dg);
+        uint16x8_t sb = vmull_u8(db, db);
+        if (high) {
+            return vaddw_u16(vaddl_u16(vget_high_u16(sr), vget_high_u16(sg)), vget_high_u16(sb));
+        }
+        return vaddw_u16(vaddl_u16(vget_low_u16(sr), vget_low_u16(sg)), vget_low_u16(sb));
+    };
+
+    uint32x4_t low = vminq_u32(squared(a, false), squared(b, false));
+    uint32x4_t high = vminq_u32(squared(a, true), squared(b, true));
+    vst1q_s32(best, vreinterpretq_s32_u32(low));
+    vst1q_s32(best + 4, vreinterpretq_s32_u32(high));
+}
+
+#endif
+
+SimdLevel detectOnce() {
+#if defined(IC_SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return SimdLevel::AVX2;
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        return SimdLevel::SSE4;
+    }
+    return SimdLevel::SCALAR;
+#elif defined(IC_SIMD_X86) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    bool sse41 = (info[2] & (1 << 19)) != 0;
+    // AVX2 also needs the OS to save YMM state (OSXSAVE + XCR0 bits 1 and 2)
+    bool osYmm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+    __cpuidex(info, 7, 0);
+    bool avx2 = osYmm && (info[1] & (1 << 5)) != 0;
+    return avx2 ? SimdLevel::AVX2 : sse41 ? SimdLevel::SSE4 : SimdLevel::SCALAR;
+#elif defined(IC_SIMD_NEON)
+    return SimdLevel::NEON;
+#else
+    return SimdLevel::SCALAR;
+#endif
+}
+
+bool supports(SimdLevel level) {
+    SimdLevel detected = detectSimdLevel();
+    switch (level) {
+        case SimdLevel::SCALAR: return true;
+        case SimdLevel::SSE4: return detected == SimdLevel::SSE4 || detected == SimdLevel::AVX2;
+        case SimdLevel::AVX2: return detected == SimdLevel::AVX2;
+        case SimdLevel::NEON: return detected == SimdLevel::NEON;
+        default: return false;
+    }
+}
+
+} // namespace
+
+SimdLevel detectSimdLevel() {
+    static const SimdLevel level = detectOnce();
+    return level;
+}
+
+BestSquaredDistanceKernel bestSquaredDistanceKernel(SimdLevel level) {
+    if (!supports(level)) {
+        return bestSquaredDistanceScalar;
+    }
+    switch (level) {
+#ifdef IC_SIMD_X86
+        case SimdLevel::SSE4: return bestSquaredDistanceSse4;
+        case SimdLevel::AVX2: return bestSquaredDistanceAvx2;
+#endif
+#ifdef IC_SIMD_NEON
+        case SimdLevel::NEON: return bestSquaredDistanceNeon;
+#endif
+        default: return bestSquaredDistanceScalar;
+    }
+}
+
+BestSquaredDistanceKernel bestSquaredDistanceKernel() {
+    static const BestSquaredDistanceKernel kernel = bestSquaredDistanceKernel(detectSimdLevel());
+    return kernel;
+}
+
+} // namespace ic
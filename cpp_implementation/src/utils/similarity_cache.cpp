@@ -0,0 +1,27 @@
+#include "utils/similarity_cache.hpp"
+#include <algorithm>
+
+namespace ic {
+
+SimilarityCache::SimilarityCache(size_t entries) {
+    if (entries == 0) {
+        return;
+    }
+
+    // Round up to a power of two (at least 2 so the shift stays below 64)
+    entries = std::min(entries, kMaxEntries);
+    int bits = 1;
+    while ((size_t(1) << bits) < entries) {
+        ++bits;
+    }
+
+    shift_ = 64 - bits;
+    entries_.resize(size_t(1) << bits);
+    clear();
+}
+
+void SimilarityCache::clear() {
+    std::fill(entries_.begin(), entries_.end(), Entry{kEmptyKey, 0.0});
+}
+
+} // namespace ic
@@ -0,0 +1,58 @@
+#include "utils/thread_pool.hpp"
+#include <algorithm>
+
+namespace ic {
+
+namespace {
+thread_local int tlsWorkerIndex = -1;
+}
+
+ThreadPool::ThreadPool(int threadCount) {
+    int count = resolveThreadCount(threadCount);
+    workers_.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        workers_.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    condition_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+int ThreadPool::currentWorkerIndex() {
+    return tlsWorkerIndex;
+}
+
+int ThreadPool::resolveThreadCount(int threadCount) {
+    if (threadCount > 0) {
+        return threadCount;
+    }
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+void ThreadPool::workerLoop(int index) {
+    tlsWorkerIndex = index;
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            condition_.wait(lock, [this]() { return stopping_ || !tasks_.empty(); });
+            // Drain remaining work before shutting down
+            if (tasks_.empty()) {
+                return;
+            }
+            task = std::move(tasks_.front());
+            tasks_.pop();
+        }
+        task();
+    }
+}
+
+} // namespace ic